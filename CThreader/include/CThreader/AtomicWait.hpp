@@ -0,0 +1,16 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+namespace CT {
+    // Futex-style parking on a 32-bit atomic (futex on Linux, WaitOnAddress on
+    // Windows). Waits may return spuriously; callers re-check the word.
+    void AtomicWait(std::atomic<uint32_t>& _word, uint32_t _old) noexcept;
+
+    // Returns false if the timeout elapsed while the word still held _old.
+    bool AtomicWaitFor(std::atomic<uint32_t>& _word, uint32_t _old, std::chrono::nanoseconds _timeout) noexcept;
+
+    void AtomicNotifyOne(std::atomic<uint32_t>& _word) noexcept;
+    void AtomicNotifyAll(std::atomic<uint32_t>& _word) noexcept;
+}
@@ -5,9 +5,20 @@
 #include <any>
 #include <expected>
 #include <atomic>
+#include <concepts>
+#include <type_traits>
+#include <span>
+#include <vector>
+#include <ranges>
+#include <chrono>
 
 #include "ThreadPool.hpp"
+#include "ParallelLoop.hpp"
 #include "Task.hpp"
+#include "CancelToken.hpp"
+#include "TaskHandle.hpp"
+#include "TaskGraph.hpp"
+#include "Coroutine.hpp"
 #include "Utils.hpp"
 
 namespace CT {
@@ -16,16 +27,150 @@ namespace CT {
         CThreader() noexcept;
         ~CThreader() noexcept;
 
-        std::expected<void, CThreaderError> Initialize(std::optional<std::size_t> _threadCount = std::nullopt) noexcept;
+        // TopologyMode::NumaAware pins workers to CPUs and keeps one queue set
+        // per NUMA node; it falls back to Flat where the layout is unknown.
+        std::expected<void, CThreaderError> Initialize(std::optional<std::size_t> _threadCount = std::nullopt, TopologyMode _mode = TopologyMode::Flat) noexcept;
+        // Elastic pool: starts with _elastic.minThreads workers, adds workers
+        // while tasks back up and retires them after keepAlive idle. maxThreads
+        // 0 means hardware_concurrency.
+        std::expected<void, CThreaderError> Initialize(const ElasticOptions& _elastic, TopologyMode _mode = TopologyMode::Flat) noexcept;
+        std::size_t ActiveThreadCount() const noexcept;
         uint64_t Enqueue(Task&& _task, TaskLevel _taskLevel = TaskLevel::Low) noexcept;
+        // Fire-and-forget: no result slot is reserved and nothing is stored
+        // when the task finishes, so only the queue cost is paid.
+        void Post(Task&& _task, TaskLevel _taskLevel = TaskLevel::Low) noexcept;
+        // Deadline variants: under SchedulingPolicy::EarliestDeadline the task
+        // runs ahead of every level, earliest _deadline first, and misses are
+        // counted in GetSchedulingStats. Other policies queue it at _taskLevel.
+        uint64_t Enqueue(Task&& _task, std::chrono::steady_clock::time_point _deadline, TaskLevel _taskLevel = TaskLevel::Low) noexcept;
+        void Post(Task&& _task, std::chrono::steady_clock::time_point _deadline, TaskLevel _taskLevel = TaskLevel::Low) noexcept;
+        // Node-targeted variants: the task goes to node _node's queues (below
+        // NodeCount()) so it runs next to memory that node allocated.
+        uint64_t EnqueueOn(std::size_t _node, Task&& _task, TaskLevel _taskLevel = TaskLevel::Low) noexcept;
+        void PostOn(std::size_t _node, Task&& _task, TaskLevel _taskLevel = TaskLevel::Low) noexcept;
+        std::size_t NodeCount() const noexcept;
+
+        // Cancellation. A cancelled task that has not started is dropped when
+        // a worker dequeues it; a running one sees the CancelToken its
+        // callable takes as first parameter stop, and should return early.
+        // Either way its result reports TaskCancelled, even if it went on to
+        // finish. Cancel(id) is false once the task has finished.
+        uint64_t Enqueue(Task&& _task, const CancelGroup& _group, TaskLevel _taskLevel = TaskLevel::Low) noexcept;
+        bool Cancel(uint64_t _taskId) noexcept;
+        void Cancel(const CancelGroup& _group) noexcept;
+
+        // Delayed and periodic tasks. They wait in the pool's timer wheel, not
+        // on a worker, and are queued at _taskLevel when due; EnqueuePeriodic
+        // first fires one interval from now. Like Post, no result is stored.
+        // A periodic task's next run is armed when the current one ends.
+        TimerId EnqueueAfter(std::chrono::steady_clock::duration _delay, Task&& _task, TaskLevel _taskLevel = TaskLevel::Low) noexcept;
+        TimerId EnqueueAt(std::chrono::steady_clock::time_point _time, Task&& _task, TaskLevel _taskLevel = TaskLevel::Low) noexcept;
+        TimerId EnqueuePeriodic(std::chrono::steady_clock::duration _interval, Task&& _task, TaskLevel _taskLevel = TaskLevel::Low) noexcept;
+        // False if the timer already fired (one-shot) or was cancelled. A run
+        // already queued still happens.
+        bool CancelTimer(TimerId _id) noexcept;
+
+        // Bulk variants: ids are reserved and the tasks queued in one pass, and
+        // only as many idle workers are woken as there are tasks. The tasks are
+        // moved from; ids come back in the same order as the tasks.
+        std::vector<uint64_t> EnqueueBatch(std::span<Task> _tasks, TaskLevel _taskLevel = TaskLevel::Low);
+        template<std::ranges::input_range Range>
+            requires (!std::convertible_to<Range, std::span<Task>>)
+                && std::constructible_from<Task, std::ranges::range_rvalue_reference_t<Range>>
+        std::vector<uint64_t> EnqueueBatch(Range&& _tasks, TaskLevel _taskLevel = TaskLevel::Low);
+        void PostBatch(std::span<Task> _tasks, TaskLevel _taskLevel = TaskLevel::Low) noexcept;
+
+        // Typed variant: the result goes straight to the returned handle and
+        // never through GetResult's result table. _func and _args are stored
+        // decayed and moved into the call, which runs once.
+        template<typename Callable, typename... Args>
+            requires std::invocable<std::decay_t<Callable>&&, std::decay_t<Args>&&...>
+        TaskHandle<std::decay_t<std::invoke_result_t<std::decay_t<Callable>&&, std::decay_t<Args>&&...>>> Enqueue(TaskLevel _taskLevel, Callable&& _func, Args&&... _args);
+
+        // Queues _func once _handle's task has finished, passing it the result
+        // by const reference (nothing for void). No thread waits in between;
+        // if the predecessor threw, _func is skipped and the error is passed
+        // on. Get() on the predecessor copies its value while continuations
+        // still read it (or waits for them, if it cannot be copied). See
+        // WhenAll / WhenAny for joins.
+        template<typename T, typename Fn>
+        TaskHandle<typename Detail::ThenResult<T, std::decay_t<Fn>>::type> Then(const TaskHandle<T>& _handle, Fn&& _func, TaskLevel _taskLevel = TaskLevel::Low);
+        std::expected<TaskHandle<void>, CThreaderError> Run(TaskGraph& _graph);
+
+        // Coroutines (see Coroutine.hpp). co_await Schedule(level) continues
+        // the calling coroutine on a worker at _taskLevel; Spawn starts
+        // _task on a worker and hands what it returns to the handle.
+        [[nodiscard]] Detail::ScheduleAwaiter Schedule(TaskLevel _taskLevel = TaskLevel::Low) noexcept;
+        template<typename T>
+        TaskHandle<T> Spawn(task<T> _task, TaskLevel _taskLevel = TaskLevel::Low);
+
+        // Runs _func over [_begin, _end) on the pool, with the calling thread
+        // taking part, and returns when every index is done. _func takes either
+        // one index or a sub-range (lo, hi). The range is split on demand, so
+        // _grain is only the smallest piece handed out; 0 picks one from the
+        // range size and thread count.
+        template<std::integral Index, typename Fn>
+            requires std::invocable<Fn&, Index> || std::invocable<Fn&, Index, Index>
+        void ParallelFor(Index _begin, Index _end, Index _grain, Fn&& _func, TaskLevel _taskLevel = TaskLevel::Low);
+        // Folds _map over [_begin, _end) with _combine, starting from
+        // _identity. _map takes one index or a sub-range (lo, hi); _combine
+        // must be associative and commutative since pieces finish in any order.
+        template<std::integral Index, typename T, typename Map, typename Combine>
+            requires (std::invocable<Map&, Index> || std::invocable<Map&, Index, Index>)
+                && std::invocable<Combine&, T, T>
+        T ParallelReduce(Index _begin, Index _end, Index _grain, T _identity, Map&& _map, Combine&& _combine, TaskLevel _taskLevel = TaskLevel::Low);
+
+        // Copies the result out and keeps its slot, so it can be read again.
+        // Only TakeResult (or ClearTasks) frees a slot: code that enqueues
+        // by id must take every result, or the table grows with each task.
         [[nodiscard]] std::expected<TaskResult, CThreaderError> GetResult(const uint64_t& _taskId) noexcept;
+        // Moves the result out and frees its slot; the id is invalid afterwards.
+        [[nodiscard]] std::expected<TaskResult, CThreaderError> TakeResult(const uint64_t& _taskId) noexcept;
 		void Stop(const CThreaderStopFlag _flag = CThreaderStopFlag::CLOSE_AFTER_COMPLETING_THE_TASKS) noexcept;
         void Start() noexcept;
         void Kill(const CThreaderStopFlag _flag = CThreaderStopFlag::CLOSE_AFTER_COMPLETING_PROCESSED_TASKS) noexcept;
+        // Drops every queued task and pending timer. TaskHandles of dropped
+        // tasks fail with "Task was dropped before it completed." right away.
 		void ClearTasks() noexcept;
+        // Blocks until every queued and running task has finished, woken by
+        // the last one rather than polling. Timers not yet due do not count.
+        // Never call it from inside a task of this threader.
+        void WaitIdle() noexcept;
+        // False if tasks were still outstanding when _timeout ran out.
+        bool WaitIdleFor(std::chrono::steady_clock::duration _timeout) noexcept;
+
+        // Wrap a wait inside a task (file read, external lock, ...) in one of
+        // these so the pool can start a compensation worker meanwhile:
+        //     auto region = threader.MarkBlocking();
+        // It retires again once the region ends. Does nothing off the workers.
+        class BlockingRegion {
+        public:
+            explicit BlockingRegion(CThreader& _threader) noexcept : m_pool(_threader.m_threadPool) { m_pool.BeginBlocking(); }
+            ~BlockingRegion() noexcept { m_pool.EndBlocking(); }
+
+            BlockingRegion(const BlockingRegion&) = delete;
+            BlockingRegion& operator=(const BlockingRegion&) = delete;
+
+        private:
+            ThreadPool& m_pool;
+        };
+        [[nodiscard]] BlockingRegion MarkBlocking() noexcept { return BlockingRegion(*this); }
+
+        // How workers choose between TaskLevels; WeightedFair 8:4:1 by default.
+        void SetScheduling(const SchedulingOptions& _options) noexcept;
+        SchedulingOptions GetScheduling() const noexcept;
+        SchedulingStats GetSchedulingStats() const noexcept;
+        // Per-worker counters and latency histograms, read without stopping
+        // the workers. Only filled in when built with CTHREADER_ENABLE_METRICS=1.
+        PoolStats GetStats() const;
+        // Cycles, instructions, cache and branch misses of the tasks run,
+        // summed per Task::SetTag. Only filled in when built with
+        // CTHREADER_ENABLE_PERF_COUNTERS=1 on Linux.
+        PerfStats GetPerfStats() const;
 
     private:
         ThreadPool m_threadPool;
-        alignas(64) std::atomic<uint64_t> m_taskIdCounter;
     };
 }
+
+#include "CThreader.ipp"
@@ -0,0 +1,166 @@
+#pragma once
+#include <memory>
+#include <tuple>
+#include <utility>
+#include <mutex>
+
+namespace CT {
+    template<typename Callable, typename... Args>
+        requires std::invocable<std::decay_t<Callable>&&, std::decay_t<Args>&&...>
+    TaskHandle<std::decay_t<std::invoke_result_t<std::decay_t<Callable>&&, std::decay_t<Args>&&...>>> CThreader::Enqueue(TaskLevel _taskLevel, Callable&& _func, Args&&... _args) {
+        using ResultType = std::decay_t<std::invoke_result_t<std::decay_t<Callable>&&, std::decay_t<Args>&&...>>;
+
+        auto state = std::make_shared<TaskState<ResultType>>();
+        Task task([state = Detail::StateOwner<ResultType>(state), fn = std::forward<Callable>(_func), tuple = std::tuple<std::decay_t<Args>...>(std::forward<Args>(_args)...)]() mutable {
+            state->Run([&]() -> decltype(auto) { return std::apply(std::move(fn), std::move(tuple)); });
+        });
+
+        task.SetTaskId(Task::kNoResultId);
+        m_threadPool.PushTask(std::move(task), _taskLevel);
+        return TaskHandle<ResultType>(std::move(state));
+    }
+
+    template<std::ranges::input_range Range>
+        requires (!std::convertible_to<Range, std::span<Task>>)
+            && std::constructible_from<Task, std::ranges::range_rvalue_reference_t<Range>>
+    std::vector<uint64_t> CThreader::EnqueueBatch(Range&& _tasks, TaskLevel _taskLevel) {
+        std::vector<Task> tasks;
+        if constexpr (std::ranges::sized_range<Range>) {
+            tasks.reserve(std::ranges::size(_tasks));
+        }
+        for (auto it = std::ranges::begin(_tasks); it != std::ranges::end(_tasks); ++it) {
+            tasks.emplace_back(std::ranges::iter_move(it));
+        }
+        return EnqueueBatch(std::span<Task>(tasks), _taskLevel);
+    }
+
+    template<typename T, typename Fn>
+    TaskHandle<typename Detail::ThenResult<T, std::decay_t<Fn>>::type> CThreader::Then(const TaskHandle<T>& _handle, Fn&& _func, TaskLevel _taskLevel) {
+        using ResultType = typename Detail::ThenResult<T, std::decay_t<Fn>>::type;
+
+        // Holds the predecessor weakly so a task that never runs does not keep
+        // itself alive through its own continuation.
+        struct Node : Continuation {
+            std::weak_ptr<TaskState<T>> pred;
+            std::shared_ptr<TaskState<ResultType>> state;
+            std::decay_t<Fn> fn;
+            ThreadPool* pool;
+            TaskLevel level;
+
+            static void Fire(Continuation* _self, TaskStateBase&) noexcept {
+                std::unique_ptr<Node> node(static_cast<Node*>(_self));
+                std::shared_ptr<TaskState<T>> pred = node->pred.lock();
+                if (!pred || pred->Error()) {
+                    node->state->SetException(pred ? pred->Error()
+                        : std::make_exception_ptr(std::runtime_error("Task was dropped before it completed.")));
+                    Detail::ValueReader<T> release(std::move(pred));
+                    return;
+                }
+
+                Task task([pred = Detail::ValueReader<T>(std::move(pred)), state = Detail::StateOwner<ResultType>(std::move(node->state)), fn = std::move(node->fn)]() mutable {
+                    state->Run([&]() -> decltype(auto) {
+                        if constexpr (std::is_void_v<T>) {
+                            return fn();
+                        }
+                        else {
+                            return fn(pred->Value());
+                        }
+                    });
+                });
+                task.SetTaskId(Task::kNoResultId);
+                node->pool->PushTask(std::move(task), node->level);
+            }
+        };
+
+        auto state = std::make_shared<TaskState<ResultType>>();
+        if (!_handle.Valid()) {
+            state->SetException(std::make_exception_ptr(std::invalid_argument("Then needs a valid TaskHandle.")));
+            return TaskHandle<ResultType>(std::move(state));
+        }
+
+        auto* node = new Node{ { &Node::Fire }, _handle.State(), state, std::forward<Fn>(_func), &m_threadPool, _taskLevel };
+        if constexpr (!std::is_void_v<T>) {
+            _handle.State()->AddReader();
+        }
+        _handle.State()->AddContinuation(node);
+        return TaskHandle<ResultType>(std::move(state));
+    }
+
+    template<typename T>
+    TaskHandle<T> CThreader::Spawn(task<T> _task, TaskLevel _taskLevel) {
+        auto state = std::make_shared<TaskState<T>>();
+        if (!_task.Valid()) {
+            state->SetException(std::make_exception_ptr(std::invalid_argument("Spawn needs a valid task.")));
+            return TaskHandle<T>(std::move(state));
+        }
+
+        const auto driver = Detail::RunDetached(std::move(_task), Detail::StateOwner<T>(state)).handle;
+        driver.promise().context = { &m_threadPool, _taskLevel };
+        Task start{ Detail::DetachedStart(driver) };
+        start.SetTaskId(Task::kNoResultId);
+        m_threadPool.PushTask(std::move(start), _taskLevel);
+        return TaskHandle<T>(std::move(state));
+    }
+
+    template<std::integral Index, typename Fn>
+        requires std::invocable<Fn&, Index> || std::invocable<Fn&, Index, Index>
+    void CThreader::ParallelFor(Index _begin, Index _end, Index _grain, Fn&& _func, TaskLevel _taskLevel) {
+        struct Body {
+            struct Partial { };
+
+            Partial Identity() const noexcept { return {}; }
+
+            void Accumulate(Partial&, Index _lo, Index _hi) {
+                if constexpr (std::invocable<Fn&, Index, Index>) {
+                    fn(_lo, _hi);
+                }
+                else {
+                    for (Index i = _lo; i < _hi; ++i) {
+                        fn(i);
+                    }
+                }
+            }
+
+            void Merge(Partial&&) const noexcept { }
+
+            Fn& fn;
+        } body{ _func };
+
+        ParallelLoop<Index, Body>(m_threadPool, body, _grain, _taskLevel).Run(_begin, _end);
+    }
+
+    template<std::integral Index, typename T, typename Map, typename Combine>
+        requires (std::invocable<Map&, Index> || std::invocable<Map&, Index, Index>)
+            && std::invocable<Combine&, T, T>
+    T CThreader::ParallelReduce(Index _begin, Index _end, Index _grain, T _identity, Map&& _map, Combine&& _combine, TaskLevel _taskLevel) {
+        struct Body {
+            T Identity() const { return identity; }
+
+            void Accumulate(T& _acc, Index _lo, Index _hi) {
+                if constexpr (std::invocable<Map&, Index, Index>) {
+                    _acc = combine(std::move(_acc), map(_lo, _hi));
+                }
+                else {
+                    for (Index i = _lo; i < _hi; ++i) {
+                        _acc = combine(std::move(_acc), map(i));
+                    }
+                }
+            }
+
+            // One call per task that ran, not per grain, so the lock is cold.
+            void Merge(T&& _partial) {
+                std::lock_guard lk(lock);
+                total = combine(std::move(total), std::move(_partial));
+            }
+
+            const T& identity;
+            Map& map;
+            Combine& combine;
+            T total;
+            SpinLock lock;
+        } body{ _identity, _map, _combine, _identity, {} };
+
+        ParallelLoop<Index, Body>(m_threadPool, body, _grain, _taskLevel).Run(_begin, _end);
+        return std::move(body.total);
+    }
+}
@@ -0,0 +1,63 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <memory>
+
+namespace CT {
+    // Read-only view a running task polls to learn it was cancelled, in the
+    // manner of std::stop_token. A task whose callable takes a CancelToken as
+    // its first parameter gets one bound to its own id (and group, if any).
+    // A default-constructed token never stops. A token bound to an id must
+    // not outlive the pool; once that task has finished it reads as stopped.
+    class CancelToken {
+    public:
+        CancelToken() noexcept = default;
+
+        bool stop_requested() const noexcept {
+            return (m_word && m_word->load(std::memory_order_acquire) != m_pending)
+                || (m_group && m_group->load(std::memory_order_acquire));
+        }
+
+        bool stop_possible() const noexcept {
+            return m_word || m_group;
+        }
+
+    private:
+        friend class ResultStore;
+        friend class CancelGroup;
+
+        // Result slot word; it leaves m_pending when the id is cancelled.
+        const std::atomic<uint64_t>* m_word{ nullptr };
+        uint64_t m_pending{ 0 };
+        std::shared_ptr<const std::atomic<bool>> m_group;
+    };
+
+    // Cancels many tasks at once: tasks enqueued with a group are skipped
+    // when dequeued after Cancel(), and running ones see their token stop.
+    // Cancelling is one store however many tasks joined. A group stays
+    // cancelled; make a new one for the next batch. Copies share the state.
+    class CancelGroup {
+    public:
+        CancelGroup() : m_state(std::make_shared<std::atomic<bool>>(false)) {}
+
+        void Cancel() const noexcept {
+            m_state->store(true, std::memory_order_release);
+        }
+
+        bool Cancelled() const noexcept {
+            return m_state->load(std::memory_order_acquire);
+        }
+
+        // For tasks that take no id (Post): capture it in the callable.
+        CancelToken Token() const noexcept {
+            CancelToken token;
+            token.m_group = m_state;
+            return token;
+        }
+
+    private:
+        friend class ResultStore;
+
+        std::shared_ptr<std::atomic<bool>> m_state;
+    };
+}
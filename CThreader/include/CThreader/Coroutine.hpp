@@ -0,0 +1,341 @@
+#pragma once
+#include <atomic>
+#include <concepts>
+#include <coroutine>
+#include <cstddef>
+#include <exception>
+#include <memory>
+#include <optional>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+
+#include "Task.hpp"
+#include "TaskHandle.hpp"
+#include "ThreadPool.hpp"
+
+// Coroutine support. A task<T> is a lazily started coroutine: nothing runs
+// until it is co_awaited (or handed to CThreader::Spawn), and the awaiting
+// coroutine is resumed straight from the awaited one's end, so a chain of
+// awaits never holds a worker while it waits. co_await threader.Schedule()
+// moves the flow onto a worker; co_await on a TaskHandle parks it until the
+// task finishes and then queues it again on the pool it last ran on.
+
+namespace CT {
+    template<typename T = void>
+    class task;
+
+    namespace Detail {
+        // Coroutine frames come from per-thread free lists in 64-byte size
+        // classes; frames over 1 KiB go to the global heap.
+        void* AllocateFrame(size_t _size);
+        void FreeFrame(void* _frame, size_t _size) noexcept;
+
+        // Queues _handle.resume() as a task; from a worker of _pool that is
+        // its own local deque.
+        inline void ResumeOn(ThreadPool& _pool, std::coroutine_handle<> _handle, TaskLevel _taskLevel) noexcept {
+            Task resume([_handle] { _handle.resume(); });
+            resume.SetTaskId(Task::kNoResultId);
+            _pool.PushTask(std::move(resume), _taskLevel);
+        }
+
+        // Where a flow goes back to after waiting on a TaskHandle. Set by
+        // Schedule and Spawn, and passed down to every task<T> it awaits.
+        struct CoroutineContext {
+            ThreadPool* pool{ nullptr };
+            TaskLevel level{ TaskLevel::Low };
+        };
+
+        class FramePromise {
+        public:
+            static void* operator new(size_t _size) { return AllocateFrame(_size); }
+            static void operator delete(void* _frame, size_t _size) noexcept { FreeFrame(_frame, _size); }
+
+            CoroutineContext context;
+        };
+
+        template<typename Promise>
+        CoroutineContext* ContextOf(std::coroutine_handle<Promise> _handle) noexcept {
+            if constexpr (std::derived_from<Promise, FramePromise>) {
+                return &_handle.promise().context;
+            }
+            else {
+                return nullptr;
+            }
+        }
+
+        // Hands the thread straight to whoever awaited the finished task.
+        struct FinalAwaiter {
+            bool await_ready() const noexcept { return false; }
+
+            template<typename Promise>
+            std::coroutine_handle<> await_suspend(std::coroutine_handle<Promise> _self) const noexcept {
+                const std::coroutine_handle<> next = _self.promise().m_continuation;
+                return next ? next : std::noop_coroutine();
+            }
+
+            void await_resume() const noexcept {}
+        };
+
+        template<typename T>
+        class TaskPromiseBase : public FramePromise {
+        public:
+            std::suspend_always initial_suspend() noexcept { return {}; }
+            FinalAwaiter final_suspend() noexcept { return {}; }
+
+            void unhandled_exception() noexcept { m_error = std::current_exception(); }
+
+            std::coroutine_handle<> m_continuation;
+            std::exception_ptr m_error;
+        };
+
+        template<typename T>
+        class TaskPromise : public TaskPromiseBase<T> {
+        public:
+            task<T> get_return_object() noexcept;
+
+            template<typename U>
+                requires std::constructible_from<T, U&&>
+            void return_value(U&& _value) noexcept(std::is_nothrow_constructible_v<T, U&&>) {
+                m_value.emplace(std::forward<U>(_value));
+            }
+
+            T Take() {
+                if (this->m_error) {
+                    std::rethrow_exception(this->m_error);
+                }
+                return std::move(*m_value);
+            }
+
+        private:
+            std::optional<T> m_value;
+        };
+
+        template<>
+        class TaskPromise<void> : public TaskPromiseBase<void> {
+        public:
+            task<void> get_return_object() noexcept;
+
+            void return_void() noexcept {}
+
+            void Take() {
+                if (m_error) {
+                    std::rethrow_exception(m_error);
+                }
+            }
+        };
+
+        // Starts the awaited task on the awaiting thread, which comes back
+        // to the awaiter through FinalAwaiter once the task is done.
+        template<typename T>
+        class TaskAwaiter {
+        public:
+            explicit TaskAwaiter(std::coroutine_handle<TaskPromise<T>> _handle) noexcept : m_handle(_handle) {}
+
+            bool await_ready() const noexcept { return !m_handle || m_handle.done(); }
+
+            template<typename Promise>
+            std::coroutine_handle<> await_suspend(std::coroutine_handle<Promise> _caller) noexcept {
+                if (const CoroutineContext* context = ContextOf(_caller)) {
+                    m_handle.promise().context = *context;
+                }
+                m_handle.promise().m_continuation = _caller;
+                return m_handle;
+            }
+
+            T await_resume() {
+                if (!m_handle) {
+                    throw std::runtime_error("task has no associated coroutine.");
+                }
+                return m_handle.promise().Take();
+            }
+
+        private:
+            std::coroutine_handle<TaskPromise<T>> m_handle;
+        };
+    }
+
+    // Move-only owner of a coroutine frame. co_await runs it to completion
+    // on the awaiting thread (until its own first suspension) and yields its
+    // return value or rethrows its exception; a task can be awaited once.
+    template<typename T>
+    class [[nodiscard]] task {
+    public:
+        using promise_type = Detail::TaskPromise<T>;
+        using ValueType = T;
+
+        task() noexcept = default;
+        explicit task(std::coroutine_handle<promise_type> _handle) noexcept : m_handle(_handle) {}
+
+        task(task&& _other) noexcept : m_handle(std::exchange(_other.m_handle, nullptr)) {}
+        task& operator=(task&& _other) noexcept {
+            if (this != &_other) {
+                if (m_handle) {
+                    m_handle.destroy();
+                }
+                m_handle = std::exchange(_other.m_handle, nullptr);
+            }
+            return *this;
+        }
+        task(const task&) = delete;
+        task& operator=(const task&) = delete;
+
+        ~task() {
+            if (m_handle) {
+                m_handle.destroy();
+            }
+        }
+
+        bool Valid() const noexcept { return static_cast<bool>(m_handle); }
+        bool IsReady() const noexcept { return m_handle && m_handle.done(); }
+
+        Detail::TaskAwaiter<T> operator co_await() && noexcept { return Detail::TaskAwaiter<T>(m_handle); }
+        Detail::TaskAwaiter<T> operator co_await() & noexcept { return Detail::TaskAwaiter<T>(m_handle); }
+
+    private:
+        std::coroutine_handle<promise_type> m_handle;
+    };
+
+    namespace Detail {
+        template<typename T>
+        task<T> TaskPromise<T>::get_return_object() noexcept {
+            return task<T>(std::coroutine_handle<TaskPromise<T>>::from_promise(*this));
+        }
+
+        inline task<void> TaskPromise<void>::get_return_object() noexcept {
+            return task<void>(std::coroutine_handle<TaskPromise<void>>::from_promise(*this));
+        }
+
+        // Result of CThreader::Schedule. Always suspends: even on a worker
+        // of the same pool the flow goes to the back of that worker's deque,
+        // which makes it a yield.
+        class ScheduleAwaiter {
+        public:
+            ScheduleAwaiter(ThreadPool& _pool, TaskLevel _taskLevel) noexcept : m_pool(_pool), m_level(_taskLevel) {}
+
+            bool await_ready() const noexcept { return false; }
+
+            template<typename Promise>
+            void await_suspend(std::coroutine_handle<Promise> _caller) const noexcept {
+                if (CoroutineContext* context = ContextOf(_caller)) {
+                    *context = { &m_pool, m_level };
+                }
+                ResumeOn(m_pool, _caller, m_level);
+            }
+
+            void await_resume() const noexcept {}
+
+        private:
+            ThreadPool& m_pool;
+            TaskLevel m_level;
+        };
+
+        // The awaiter is its own continuation node, so waiting allocates
+        // nothing. Whichever of await_suspend and Fire flips m_fired second
+        // resumes the coroutine: a handle that finishes while the node is
+        // being added is not waited for at all.
+        template<typename T>
+        class HandleAwaiter : public Continuation {
+        public:
+            explicit HandleAwaiter(const TaskHandle<T>& _handle) noexcept
+                : Continuation{ &Fire }, m_handle(_handle) {}
+
+            bool await_ready() const noexcept { return !m_handle.Valid() || m_handle.IsReady(); }
+
+            template<typename Promise>
+            bool await_suspend(std::coroutine_handle<Promise> _caller) noexcept {
+                if (const CoroutineContext* context = ContextOf(_caller)) {
+                    m_context = *context;
+                }
+                m_caller = _caller;
+                m_handle.State()->AddContinuation(this);
+                return !m_fired.exchange(true, std::memory_order_acq_rel);
+            }
+
+            T await_resume() { return m_handle.Get(); }
+
+        private:
+            static void Fire(Continuation* _self, TaskStateBase&) noexcept {
+                auto* self = static_cast<HandleAwaiter*>(_self);
+                if (!self->m_fired.exchange(true, std::memory_order_acq_rel)) {
+                    return;
+                }
+                // The frame may be gone as soon as the caller resumes.
+                const std::coroutine_handle<> caller = self->m_caller;
+                if (ThreadPool* pool = self->m_context.pool) {
+                    ResumeOn(*pool, caller, self->m_context.level);
+                }
+                else {
+                    caller.resume();
+                }
+            }
+
+            TaskHandle<T> m_handle;
+            std::coroutine_handle<> m_caller;
+            CoroutineContext m_context;
+            std::atomic<bool> m_fired{ false };
+        };
+
+        // Self-destroying coroutine that runs a task<T> for CThreader::Spawn
+        // and hands its outcome to a TaskState.
+        struct DetachedCoroutine {
+            struct promise_type : FramePromise {
+                DetachedCoroutine get_return_object() noexcept {
+                    return { std::coroutine_handle<promise_type>::from_promise(*this) };
+                }
+                std::suspend_always initial_suspend() noexcept { return {}; }
+                std::suspend_never final_suspend() noexcept { return {}; }
+                void return_void() noexcept {}
+                void unhandled_exception() noexcept { std::terminate(); }
+            };
+
+            std::coroutine_handle<promise_type> handle;
+        };
+
+        // Callable of a DetachedCoroutine's first run. Dropped without
+        // running, it destroys the frame, whose StateOwner then fails the
+        // handle Spawn returned.
+        class DetachedStart {
+        public:
+            explicit DetachedStart(std::coroutine_handle<> _handle) noexcept : m_handle(_handle) {}
+            DetachedStart(DetachedStart&& _other) noexcept : m_handle(std::exchange(_other.m_handle, nullptr)) {}
+            DetachedStart& operator=(DetachedStart&&) = delete;
+
+            ~DetachedStart() {
+                if (m_handle) {
+                    m_handle.destroy();
+                }
+            }
+
+            void operator()() { std::exchange(m_handle, nullptr).resume(); }
+
+        private:
+            std::coroutine_handle<> m_handle;
+        };
+
+        template<typename T>
+        DetachedCoroutine RunDetached(task<T> _task, StateOwner<T> _state) {
+            try {
+                if constexpr (std::is_void_v<T>) {
+                    co_await std::move(_task);
+                    _state->SetValue();
+                }
+                else {
+                    _state->SetValue(co_await std::move(_task));
+                }
+            }
+            catch (...) {
+                _state->SetException(std::current_exception());
+            }
+        }
+    }
+
+    // co_await handle: parks the coroutine until the handle's task is done,
+    // then moves the result out like Get(). A coroutine on the pool is
+    // queued again at its level; one off the pool resumes on the thread
+    // that completed the task.
+    template<typename T>
+    Detail::HandleAwaiter<T> operator co_await(const TaskHandle<T>& _handle) noexcept {
+        return Detail::HandleAwaiter<T>(_handle);
+    }
+}
@@ -0,0 +1,110 @@
+#pragma once
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+
+#include "SpinLock.hpp"
+
+namespace CT {
+    // Earliest-deadline-first queue split into shards, each a binary min-heap
+    // under its own spin lock. Producers push to their own shard, so bursts do
+    // not contend on one lock. Each shard publishes its earliest deadline, and
+    // a consumer pops from the shard with the smallest one. The order is exact
+    // for every shard and exact across shards except for pushes that race the
+    // pop. Equal deadlines leave a shard in FIFO order.
+    template<typename T>
+    class DeadlineQueue {
+    public:
+        static constexpr int64_t kNone = std::numeric_limits<int64_t>::max();
+
+        explicit DeadlineQueue(size_t _shards = 1)
+            : m_shards(std::max<size_t>(_shards, 1)) {
+            for (auto& shard : m_shards) {
+                shard = std::make_unique<Shard>();
+            }
+        }
+
+        DeadlineQueue(const DeadlineQueue&) = delete;
+        DeadlineQueue& operator=(const DeadlineQueue&) = delete;
+
+        void push(size_t _shard, int64_t _deadline, T&& v) {
+            Shard& shard = *m_shards[_shard % m_shards.size()];
+            {
+                std::lock_guard lock(shard.lock);
+                shard.heap.push_back(Item{ _deadline, shard.seq++, std::move(v) });
+                std::push_heap(shard.heap.begin(), shard.heap.end(), Later);
+                shard.earliest.store(shard.heap.front().deadline, std::memory_order_release);
+            }
+            m_size.fetch_add(1, std::memory_order_release);
+        }
+
+        // Pops the earliest deadline, looking at _home's shard first on ties.
+        bool try_pop(size_t _home, T& _out, int64_t& _deadline) {
+            const size_t n = m_shards.size();
+            while (m_size.load(std::memory_order_acquire) != 0) {
+                size_t best = n;
+                int64_t bestDeadline = kNone;
+                for (size_t i = 0; i < n; ++i) {
+                    const size_t index = (_home + i) % n;
+                    const int64_t d = m_shards[index]->earliest.load(std::memory_order_acquire);
+                    if (d < bestDeadline) {
+                        bestDeadline = d;
+                        best = index;
+                    }
+                }
+                if (best == n) {
+                    return false; // a push is between its heap insert and m_size
+                }
+
+                Shard& shard = *m_shards[best];
+                std::lock_guard lock(shard.lock);
+                if (shard.heap.empty()) {
+                    continue; // drained by another consumer meanwhile
+                }
+                std::pop_heap(shard.heap.begin(), shard.heap.end(), Later);
+                _out = std::move(shard.heap.back().value);
+                _deadline = shard.heap.back().deadline;
+                shard.heap.pop_back();
+                shard.earliest.store(shard.heap.empty() ? kNone : shard.heap.front().deadline, std::memory_order_release);
+                m_size.fetch_sub(1, std::memory_order_relaxed);
+                return true;
+            }
+            return false;
+        }
+
+        bool empty() const noexcept {
+            return m_size.load(std::memory_order_acquire) == 0;
+        }
+
+        size_t size() const noexcept {
+            return m_size.load(std::memory_order_relaxed);
+        }
+
+    private:
+        struct Item {
+            int64_t deadline;
+            uint64_t seq;
+            T value;
+        };
+
+        // Heap comparator: the top is the earliest deadline, oldest first.
+        static bool Later(const Item& _a, const Item& _b) noexcept {
+            return _a.deadline != _b.deadline ? _a.deadline > _b.deadline : _a.seq > _b.seq;
+        }
+
+        struct alignas(64) Shard {
+            SpinLock lock;
+            std::vector<Item> heap;
+            uint64_t seq{ 0 };
+            std::atomic<int64_t> earliest{ kNone };
+        };
+
+        std::vector<std::unique_ptr<Shard>> m_shards;
+        alignas(64) std::atomic<size_t> m_size{ 0 };
+    };
+}
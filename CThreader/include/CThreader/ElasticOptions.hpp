@@ -0,0 +1,28 @@
+#pragma once
+#include <chrono>
+#include <cstddef>
+
+namespace CT {
+    // Bounds and triggers for resizing the pool while it runs. maxThreads 0
+    // keeps the pool fixed at the Initialize thread count.
+    struct ElasticOptions {
+        // Workers never retire below this many.
+        std::size_t minThreads{ 1 };
+        // Worker slots are allocated up to this many at Start.
+        std::size_t maxThreads{ 0 };
+        // A backlog of this many queued tasks per running worker adds a
+        // worker straight away.
+        std::size_t growDepth{ 64 };
+        // A backlog that lasts this long with no idle worker adds a worker.
+        std::chrono::microseconds growAfter{ 2'000 };
+        // A worker parked this long retires (while above minThreads).
+        std::chrono::milliseconds keepAlive{ 5'000 };
+        // Extra workers allowed, beyond maxThreads, while tasks are blocked in
+        // a BlockingRegion or flagged by the watchdog. Each retires once the
+        // blocked task moves on.
+        std::size_t maxCompensation{ 4 };
+        // Watchdog: a task running longer than this counts as blocked. 0
+        // turns the watchdog off.
+        std::chrono::milliseconds stallAfter{ 0 };
+    };
+}
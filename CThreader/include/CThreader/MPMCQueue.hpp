@@ -0,0 +1,249 @@
+#pragma once
+#include <atomic>
+#include <memory>
+#include <cstddef>
+#include <cstdint>
+#include <bit>
+#include <algorithm>
+
+#include "CpuRelax.hpp"
+
+namespace CT {
+    // Lock-free MPMC queue built from sequence-numbered rings (Vyukov).
+    // When the tail ring is full it is closed and a ring twice its size is
+    // linked behind it, so push never fails and pop stays O(1). Drained rings
+    // are kept until destruction; because capacities double, their count is
+    // bounded by log2(peak backlog).
+    template<typename T>
+    class MPMCQueue {
+    public:
+        explicit MPMCQueue(size_t _capacity = 64) {
+            m_first = new Segment(RoundCapacity(_capacity));
+            m_head.store(m_first, std::memory_order_relaxed);
+            m_tail.store(m_first, std::memory_order_relaxed);
+        }
+
+        ~MPMCQueue() {
+            Segment* seg = m_first;
+            while (seg) {
+                Segment* next = seg->next.load(std::memory_order_relaxed);
+                delete seg;
+                seg = next;
+            }
+        }
+
+        MPMCQueue(const MPMCQueue&) = delete;
+        MPMCQueue& operator=(const MPMCQueue&) = delete;
+
+        void push(T&& v) {
+            for (;;) {
+                Segment* seg = m_tail.load(std::memory_order_acquire);
+                if (seg->try_push(v)) {
+                    return;
+                }
+                Grow(seg, seg->capacity() * 2);
+            }
+        }
+
+        // Claims a block of positions per ring with a single CAS.
+        void push_bulk(T* items, size_t n) {
+            while (n > 0) {
+                Segment* seg = m_tail.load(std::memory_order_acquire);
+                const size_t pushed = seg->try_push_bulk(items, n);
+                items += pushed;
+                n -= pushed;
+                if (pushed == 0) {
+                    Grow(seg, std::max(seg->capacity() * 2, RoundCapacity(n)));
+                }
+            }
+        }
+
+        bool try_pop(T& out) {
+            for (;;) {
+                Segment* seg = m_head.load(std::memory_order_acquire);
+                if (seg->try_pop(out)) {
+                    return true;
+                }
+
+                Segment* next = seg->next.load(std::memory_order_acquire);
+                if (!next || !seg->drained()) {
+                    return false;
+                }
+                m_head.compare_exchange_strong(seg, next, std::memory_order_acq_rel, std::memory_order_acquire);
+            }
+        }
+
+        bool empty() const {
+            return size() == 0;
+        }
+
+        // Approximate while producers/consumers are active.
+        size_t size() const {
+            size_t total = 0;
+            for (Segment* seg = m_head.load(std::memory_order_acquire); seg; seg = seg->next.load(std::memory_order_acquire)) {
+                total += seg->size();
+            }
+            return total;
+        }
+
+        void reserve(size_t n) {
+            Segment* seg = m_tail.load(std::memory_order_acquire);
+            if (n > seg->capacity()) {
+                Grow(seg, RoundCapacity(n));
+            }
+        }
+
+    private:
+        static constexpr size_t kClosed = size_t(1) << (sizeof(size_t) * 8 - 1);
+
+        struct Cell {
+            std::atomic<size_t> seq;
+            T value;
+        };
+
+        struct Segment {
+            explicit Segment(size_t _capacity)
+                : mask(_capacity - 1), cells(new Cell[_capacity]) {
+                for (size_t i = 0; i < _capacity; ++i) {
+                    cells[i].seq.store(i, std::memory_order_relaxed);
+                }
+            }
+
+            size_t capacity() const noexcept { return mask + 1; }
+
+            bool try_push(T& v) {
+                size_t pos = enqueuePos.load(std::memory_order_relaxed);
+                for (;;) {
+                    if (pos & kClosed) {
+                        return false;
+                    }
+
+                    Cell& c = cells[pos & mask];
+                    const size_t seq = c.seq.load(std::memory_order_acquire);
+                    const intptr_t dif = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+                    if (dif == 0) {
+                        if (enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                            c.value = std::move(v);
+                            c.seq.store(pos + 1, std::memory_order_release);
+                            return true;
+                        }
+                    }
+                    else if (dif < 0) {
+                        // Full: close so no one pushes here once consumers move on.
+                        enqueuePos.fetch_or(kClosed, std::memory_order_acq_rel);
+                        return false;
+                    }
+                    else {
+                        pos = enqueuePos.load(std::memory_order_relaxed);
+                    }
+                }
+            }
+
+            size_t try_push_bulk(T* items, size_t n) {
+                size_t pos = enqueuePos.load(std::memory_order_relaxed);
+                size_t count = 0;
+                for (;;) {
+                    if (pos & kClosed) {
+                        return 0;
+                    }
+
+                    const intptr_t used = static_cast<intptr_t>(pos - dequeuePos.load(std::memory_order_acquire));
+                    if (used < 0) {
+                        // pos is stale: consumers have already moved past it.
+                        pos = enqueuePos.load(std::memory_order_relaxed);
+                        continue;
+                    }
+                    count = std::min(n, capacity() - std::min(static_cast<size_t>(used), capacity()));
+                    if (count == 0) {
+                        // Looks full. Close only if it is, by the same cell
+                        // check as try_push; otherwise pos was stale.
+                        const size_t seq = cells[pos & mask].seq.load(std::memory_order_acquire);
+                        if (static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos) < 0) {
+                            enqueuePos.fetch_or(kClosed, std::memory_order_acq_rel);
+                            return 0;
+                        }
+                        pos = enqueuePos.load(std::memory_order_relaxed);
+                        continue;
+                    }
+                    if (enqueuePos.compare_exchange_weak(pos, pos + count, std::memory_order_relaxed)) {
+                        break;
+                    }
+                }
+
+                for (size_t i = 0; i < count; ++i) {
+                    Cell& c = cells[(pos + i) & mask];
+                    // A consumer may still be moving the previous lap's value out.
+                    while (c.seq.load(std::memory_order_acquire) != pos + i) {
+                        CpuRelax();
+                    }
+                    c.value = std::move(items[i]);
+                    c.seq.store(pos + i + 1, std::memory_order_release);
+                }
+                return count;
+            }
+
+            bool try_pop(T& out) {
+                size_t pos = dequeuePos.load(std::memory_order_relaxed);
+                for (;;) {
+                    Cell& c = cells[pos & mask];
+                    const size_t seq = c.seq.load(std::memory_order_acquire);
+                    const intptr_t dif = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos + 1);
+                    if (dif == 0) {
+                        if (dequeuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                            out = std::move(c.value);
+                            c.seq.store(pos + mask + 1, std::memory_order_release);
+                            return true;
+                        }
+                    }
+                    else if (dif < 0) {
+                        return false;
+                    }
+                    else {
+                        pos = dequeuePos.load(std::memory_order_relaxed);
+                    }
+                }
+            }
+
+            bool drained() const noexcept {
+                const size_t e = enqueuePos.load(std::memory_order_acquire);
+                return (e & kClosed) && dequeuePos.load(std::memory_order_acquire) == (e & ~kClosed);
+            }
+
+            size_t size() const noexcept {
+                const size_t d = dequeuePos.load(std::memory_order_acquire);
+                const size_t e = enqueuePos.load(std::memory_order_acquire) & ~kClosed;
+                return e > d ? e - d : 0;
+            }
+
+            alignas(64) std::atomic<size_t> enqueuePos{ 0 };
+            alignas(64) std::atomic<size_t> dequeuePos{ 0 };
+            alignas(64) std::atomic<Segment*> next{ nullptr };
+            const size_t mask;
+            std::unique_ptr<Cell[]> cells;
+        };
+
+        static size_t RoundCapacity(size_t n) noexcept {
+            return std::bit_ceil(std::max<size_t>(n, 2));
+        }
+
+        void Grow(Segment* seg, size_t capacity) {
+            Segment* next = seg->next.load(std::memory_order_acquire);
+            if (!next) {
+                seg->enqueuePos.fetch_or(kClosed, std::memory_order_acq_rel);
+
+                Segment* fresh = new Segment(capacity);
+                if (seg->next.compare_exchange_strong(next, fresh, std::memory_order_acq_rel, std::memory_order_acquire)) {
+                    next = fresh;
+                }
+                else {
+                    delete fresh;
+                }
+            }
+            m_tail.compare_exchange_strong(seg, next, std::memory_order_acq_rel, std::memory_order_acquire);
+        }
+
+        alignas(64) std::atomic<Segment*> m_head{ nullptr };
+        alignas(64) std::atomic<Segment*> m_tail{ nullptr };
+        Segment* m_first{ nullptr };
+    };
+}
@@ -0,0 +1,137 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cstdint>
+#include <vector>
+
+#include "Task.hpp"
+
+// CTHREADER_ENABLE_METRICS (default 0, set in Task.hpp) switches the pool's
+// counters on. At 0 every hook below is an empty inline function and tasks
+// carry no timestamp, so nothing is left of them in the binary.
+
+namespace CT {
+    inline constexpr bool kMetricsEnabled = CTHREADER_ENABLE_METRICS != 0;
+
+    // Log2-bucketed nanosecond histogram: bucket 0 holds 0ns, bucket b > 0
+    // holds [2^(b-1), 2^b). The top bucket also takes everything longer.
+    struct LatencyHistogram {
+        static constexpr size_t kBuckets = 40;
+
+        std::array<uint64_t, kBuckets> counts{};
+
+        static constexpr size_t BucketOf(uint64_t _ns) noexcept {
+            const size_t bucket = static_cast<size_t>(std::bit_width(_ns));
+            return bucket < kBuckets ? bucket : kBuckets - 1;
+        }
+
+        uint64_t Count() const noexcept;
+        // Upper bound, in ns, of the bucket holding quantile _q (0 to 1).
+        uint64_t Percentile(double _q) const noexcept;
+        LatencyHistogram& operator+=(const LatencyHistogram& _other) noexcept;
+    };
+
+    struct WorkerMetrics {
+        // Indexed by priority band (TaskLevel value); deadline tasks apart.
+        std::array<uint64_t, kPriorityBands> executed{};
+        uint64_t deadlineExecuted{ 0 };
+        // Push to start, and start to end, of every task run.
+        LatencyHistogram queueWait;
+        LatencyHistogram execution;
+        // Times the worker found nothing and started spinning, and times
+        // it went on to park.
+        uint64_t idle{ 0 };
+        uint64_t parks{ 0 };
+        // Tasks taken from another worker's deque, and sweeps over the
+        // victims that came back empty.
+        uint64_t steals{ 0 };
+        uint64_t stealMisses{ 0 };
+        // Deepest this worker saw its own deque band, and a shared queue
+        // band it pushed to.
+        size_t localDepthHighWater{ 0 };
+        size_t globalDepthHighWater{ 0 };
+
+        WorkerMetrics& operator+=(const WorkerMetrics& _other) noexcept;
+    };
+
+    struct PoolStats {
+        // False when built without CTHREADER_ENABLE_METRICS; all else is 0.
+        bool enabled{ kMetricsEnabled };
+        // One entry per worker slot, retired slots included.
+        std::vector<WorkerMetrics> workers;
+        // Tasks run, and pushes made, by threads outside the pool
+        // (ParallelFor callers helping out, producers).
+        WorkerMetrics external;
+        WorkerMetrics total;
+        // Contended SpinLock::lock calls, process-wide: rounds spent
+        // retrying and how many of them yielded the CPU.
+        uint64_t spinLockSpins{ 0 };
+        uint64_t spinLockYields{ 0 };
+    };
+
+    namespace Detail {
+        // Called once per contended lock(), never on the uncontended path.
+        void RecordSpin(uint64_t _spins, uint64_t _yields) noexcept;
+        void ReadSpins(uint64_t& _spins, uint64_t& _yields) noexcept;
+
+        inline int64_t MetricsNow() noexcept {
+            if constexpr (kMetricsEnabled) {
+                return std::chrono::steady_clock::now().time_since_epoch().count();
+            }
+            else {
+                return 0;
+            }
+        }
+
+#if CTHREADER_ENABLE_METRICS
+        // Live counters of one worker, on their own cache lines. Only the
+        // owner writes (load + store, no RMW); Snapshot may read any time.
+        // A shared block, for threads outside the pool, uses fetch_add.
+        class alignas(64) MetricsBlock {
+        public:
+            explicit MetricsBlock(bool _shared = false) noexcept : m_shared(_shared) {}
+
+            void Executed(size_t _band, int64_t _queuedAt, int64_t _start, int64_t _end) noexcept;
+            void Idle() noexcept { Bump(m_idle); }
+            void Parked() noexcept { Bump(m_parks); }
+            void Stole() noexcept { Bump(m_steals); }
+            void StealMissed() noexcept { Bump(m_stealMisses); }
+            void LocalDepth(size_t _depth) noexcept { Raise(m_localHigh, _depth); }
+            void GlobalDepth(size_t _depth) noexcept { Raise(m_globalHigh, _depth); }
+            void Snapshot(WorkerMetrics& _out) const noexcept;
+
+        private:
+            void Bump(std::atomic<uint64_t>& _counter, uint64_t _n = 1) noexcept;
+            void Raise(std::atomic<size_t>& _high, size_t _value) noexcept;
+
+            const bool m_shared;
+            // One slot past the bands for deadline tasks.
+            std::array<std::atomic<uint64_t>, kPriorityBands + 1> m_executed{};
+            std::array<std::atomic<uint64_t>, LatencyHistogram::kBuckets> m_wait{};
+            std::array<std::atomic<uint64_t>, LatencyHistogram::kBuckets> m_run{};
+            std::atomic<uint64_t> m_idle{ 0 };
+            std::atomic<uint64_t> m_parks{ 0 };
+            std::atomic<uint64_t> m_steals{ 0 };
+            std::atomic<uint64_t> m_stealMisses{ 0 };
+            std::atomic<size_t> m_localHigh{ 0 };
+            std::atomic<size_t> m_globalHigh{ 0 };
+        };
+#else
+        class MetricsBlock {
+        public:
+            explicit MetricsBlock(bool = false) noexcept {}
+
+            void Executed(size_t, int64_t, int64_t, int64_t) noexcept {}
+            void Idle() noexcept {}
+            void Parked() noexcept {}
+            void Stole() noexcept {}
+            void StealMissed() noexcept {}
+            void LocalDepth(size_t) noexcept {}
+            void GlobalDepth(size_t) noexcept {}
+            void Snapshot(WorkerMetrics&) const noexcept {}
+        };
+#endif
+    }
+}
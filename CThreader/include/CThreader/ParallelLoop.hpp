@@ -0,0 +1,133 @@
+#pragma once
+#include <atomic>
+#include <concepts>
+#include <cstdint>
+#include <exception>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <algorithm>
+
+#include "ThreadPool.hpp"
+#include "Task.hpp"
+#include "CpuRelax.hpp"
+
+namespace CT {
+    // Recursive range splitter behind CThreader::ParallelFor / ParallelReduce.
+    // Splitting is lazy (Tzannes et al., "Lazy Binary Splitting"): a running
+    // range hands its upper half to the pool only when the calling thread has
+    // nothing left for others to steal. Ranges nobody steals are walked grain
+    // by grain with a single check in between, so a loop costs a few tasks per
+    // thread however small the grain is.
+    //
+    // Body provides, for some accumulator type Partial:
+    //   Partial Identity();
+    //   void Accumulate(Partial&, Index _lo, Index _hi);
+    //   void Merge(Partial&&);
+    template<std::integral Index, typename Body>
+    class ParallelLoop {
+    public:
+        // Grain used when the caller passes 0: this many chunks per thread.
+        static constexpr uint64_t kChunksPerThread = 64;
+
+        ParallelLoop(ThreadPool& _pool, Body& _body, Index _grain, TaskLevel _taskLevel) noexcept
+            : m_pool(_pool), m_body(_body), m_level(_taskLevel),
+              m_grain(_grain > 0 ? static_cast<uint64_t>(_grain) : 0) { }
+
+        ParallelLoop(const ParallelLoop&) = delete;
+        ParallelLoop& operator=(const ParallelLoop&) = delete;
+
+        // Returns once every iteration of [_begin, _end) has run; the calling
+        // thread works on the range and on queued tasks meanwhile. The first
+        // exception thrown by the body is rethrown here and the chunks that had
+        // not started yet are skipped.
+        void Run(Index _begin, Index _end) {
+            if (_end <= _begin) {
+                return;
+            }
+
+            const uint64_t total = Size(_begin, _end);
+            if (m_grain == 0) {
+                m_grain = std::max<uint64_t>(1, total / (std::max<size_t>(m_pool.ThreadCount(), 1) * kChunksPerThread));
+            }
+
+            m_remaining.store(total, std::memory_order_relaxed);
+            RunRange(_begin, _end);
+
+            uint32_t spins = 0;
+            while (m_remaining.load(std::memory_order_acquire) != 0) {
+                if (m_pool.RunPendingTask()) {
+                    spins = 0;
+                }
+                else if (++spins < 64) {
+                    CpuRelax();
+                }
+                else {
+                    std::this_thread::yield();
+                }
+            }
+
+            if (m_error) {
+                std::rethrow_exception(m_error);
+            }
+        }
+
+    private:
+        using Unsigned = std::make_unsigned_t<Index>;
+
+        static uint64_t Size(Index _lo, Index _hi) noexcept {
+            return static_cast<uint64_t>(static_cast<Unsigned>(static_cast<Unsigned>(_hi) - static_cast<Unsigned>(_lo)));
+        }
+
+        static Index Advance(Index _lo, uint64_t _n) noexcept {
+            return static_cast<Index>(static_cast<Unsigned>(static_cast<Unsigned>(_lo) + static_cast<Unsigned>(_n)));
+        }
+
+        void RunRange(Index _lo, Index _hi) noexcept {
+            const Index first = _lo;
+            try {
+                auto acc = m_body.Identity();
+                while (Size(_lo, _hi) > m_grain && !m_failed.load(std::memory_order_relaxed)) {
+                    if (m_pool.ShouldSplit(m_level)) {
+                        const Index mid = Advance(_lo, Size(_lo, _hi) / 2);
+                        Spawn(mid, _hi);
+                        _hi = mid;
+                        continue;
+                    }
+
+                    const Index next = Advance(_lo, m_grain);
+                    m_body.Accumulate(acc, _lo, next);
+                    _lo = next;
+                }
+
+                if (!m_failed.load(std::memory_order_relaxed)) {
+                    m_body.Accumulate(acc, _lo, _hi);
+                    m_body.Merge(std::move(acc));
+                }
+            }
+            catch (...) {
+                if (!m_failed.exchange(true, std::memory_order_relaxed)) {
+                    m_error = std::current_exception();
+                }
+            }
+
+            // Last touch of *this: Run() may return as soon as this hits zero.
+            m_remaining.fetch_sub(Size(first, _hi), std::memory_order_acq_rel);
+        }
+
+        void Spawn(Index _lo, Index _hi) noexcept {
+            Task task([this, _lo, _hi]() { RunRange(_lo, _hi); });
+            task.SetTaskId(Task::kNoResultId);
+            m_pool.PushTask(std::move(task), m_level);
+        }
+
+        ThreadPool& m_pool;
+        Body& m_body;
+        const TaskLevel m_level;
+        uint64_t m_grain;
+
+        alignas(64) std::atomic<uint64_t> m_remaining{ 0 };
+        std::atomic<bool> m_failed{ false };
+        std::exception_ptr m_error;
+    };
+}
@@ -0,0 +1,92 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "Task.hpp"
+
+// CTHREADER_ENABLE_PERF_COUNTERS (default 0, set in Task.hpp) makes each
+// thread that runs tasks open its own perf_event_open group (cycles,
+// instructions, cache misses, branch misses; user space only) and read it
+// before and after every task. That is two read() calls per task, so it is
+// for profiling runs, not production. Elsewhere than Linux, or where the
+// kernel refuses the events (perf_event_paranoid, containers, VMs without a
+// PMU), nothing is counted and PerfStats::available stays false.
+
+namespace CT {
+    inline constexpr bool kPerfCountersEnabled = CTHREADER_ENABLE_PERF_COUNTERS != 0;
+    // Task::SetTag values at or above this share the last slot.
+    inline constexpr size_t kPerfTags = 64;
+
+    struct PerfCounters {
+        uint64_t tasks{ 0 };
+        uint64_t cycles{ 0 };
+        uint64_t instructions{ 0 };
+        // Usually last-level cache misses; the kernel picks the event.
+        uint64_t cacheMisses{ 0 };
+        uint64_t branchMisses{ 0 };
+
+        double InstructionsPerCycle() const noexcept {
+            return cycles != 0 ? static_cast<double>(instructions) / static_cast<double>(cycles) : 0.0;
+        }
+
+        PerfCounters& operator+=(const PerfCounters& _other) noexcept;
+    };
+
+    struct PerfStats {
+        // True if at least one task was counted.
+        bool available{ false };
+        // Indexed by Task::GetTag(); 0 holds untagged tasks.
+        std::array<PerfCounters, kPerfTags> tags{};
+        // All tags, per worker slot and for threads outside the pool.
+        std::vector<PerfCounters> workers;
+        PerfCounters external;
+    };
+
+    namespace Detail {
+        struct PerfSample {
+            std::array<uint64_t, 4> values{};
+        };
+
+#if CTHREADER_ENABLE_PERF_COUNTERS
+        // Reads the calling thread's counters, opening them on first use.
+        // False if this thread has none.
+        bool PerfRead(PerfSample& _out) noexcept;
+
+        // Counts of the tasks one worker ran, per tag, on their own cache
+        // lines. Owner-written with load + store like MetricsBlock; a shared
+        // block, for threads outside the pool, uses fetch_add.
+        class alignas(64) PerfBlock {
+        public:
+            explicit PerfBlock(bool _shared = false) noexcept : m_shared(_shared) {}
+
+            void Record(uint32_t _tag, const PerfSample& _before, const PerfSample& _after) noexcept;
+            // Adds to _tags and _total, and sets _available if anything was read.
+            void Snapshot(std::array<PerfCounters, kPerfTags>& _tags, PerfCounters& _total, bool& _available) const noexcept;
+
+        private:
+            struct Slot {
+                std::atomic<uint64_t> tasks{ 0 };
+                std::array<std::atomic<uint64_t>, 4> values{};
+            };
+
+            void Bump(std::atomic<uint64_t>& _counter, uint64_t _n) noexcept;
+
+            const bool m_shared;
+            std::array<Slot, kPerfTags> m_slots{};
+        };
+#else
+        inline bool PerfRead(PerfSample&) noexcept { return false; }
+
+        class PerfBlock {
+        public:
+            explicit PerfBlock(bool = false) noexcept {}
+
+            void Record(uint32_t, const PerfSample&, const PerfSample&) noexcept {}
+            void Snapshot(std::array<PerfCounters, kPerfTags>&, PerfCounters&, bool&) const noexcept {}
+        };
+#endif
+    }
+}
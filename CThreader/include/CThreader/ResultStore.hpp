@@ -0,0 +1,81 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <expected>
+#include <memory>
+#include <span>
+
+#include "TaskResult.hpp"
+#include "CancelToken.hpp"
+#include "Utils.hpp"
+
+namespace CT {
+    // Slot map holding the results of tasks enqueued by id. A task id is
+    // (generation << 32 | slot index); TakeResult frees the slot and bumps the
+    // generation, so stale ids are rejected and memory tracks the number of
+    // results still outstanding instead of the number of tasks ever run. Get
+    // leaves the slot in place: results read only with Get are never freed.
+    class ResultStore {
+    public:
+        ResultStore() noexcept = default;
+        ~ResultStore();
+
+        ResultStore(const ResultStore&) = delete;
+        ResultStore& operator=(const ResultStore&) = delete;
+
+        uint64_t Acquire();
+        // Fills _ids with one free-list detach plus one fetch_add for fresh slots.
+        void AcquireBatch(std::span<uint64_t> _ids);
+        // Ties a pending id to _group until the slot is freed.
+        void Join(uint64_t _id, const CancelGroup& _group) noexcept;
+        // Publish and Fail leave a cancelled slot cancelled, and a result
+        // that lands after its group was cancelled is dropped as well.
+        void Publish(uint64_t _id, TaskResult&& _result) noexcept;
+        // _error is what Get/Take report: TaskFailed, DeadlineMissed or TaskCancelled.
+        void Fail(uint64_t _id, CThreaderError _error = CThreaderError::TaskFailed) noexcept;
+        void Release(uint64_t _id) noexcept;
+        // One CAS on the slot; false once the task finished or the id is stale.
+        bool Cancel(uint64_t _id) noexcept;
+        // Stops once the id or its group is cancelled. Already stopped if
+        // the id is no longer pending.
+        CancelToken Token(uint64_t _id) noexcept;
+
+        std::expected<TaskResult, CThreaderError> Get(uint64_t _id) noexcept;
+        std::expected<TaskResult, CThreaderError> Take(uint64_t _id) noexcept;
+
+    private:
+        enum SlotState : uint32_t { Free = 0, Pending = 1, Ready = 2, Failed = 3, Busy = 4, Missed = 5, Cancelled = 6 };
+
+        struct Slot {
+            // generation << 32 | SlotState
+            std::atomic<uint64_t> word{ uint64_t(1) << 32 };
+            std::atomic<uint32_t> next{ 0 };
+            TaskResult value;
+            // Set by Join before the task is queued. Kept past Recycle, until
+            // the slot is claimed again, since the task may still be running.
+            std::shared_ptr<std::atomic<bool>> group;
+        };
+
+        static constexpr size_t kBaseChunk = 1024;
+        static constexpr size_t kMaxChunks = 22; // kBaseChunk * (2^22 - 1) > 2^32 slots
+
+        static constexpr uint64_t Word(uint32_t _generation, SlotState _state) noexcept {
+            return (uint64_t(_generation) << 32) | _state;
+        }
+        static constexpr uint32_t GenerationOf(uint64_t _value) noexcept { return static_cast<uint32_t>(_value >> 32); }
+        static constexpr uint32_t IndexOf(uint64_t _id) noexcept { return static_cast<uint32_t>(_id); }
+
+        Slot* Locate(uint32_t _index) noexcept;
+        Slot* Find(uint64_t _id) noexcept;
+        uint64_t Claim(uint32_t _index, Slot& _slot) noexcept;
+        void Recycle(uint32_t _index, Slot& _slot, uint32_t _generation) noexcept;
+        // Moves a Pending slot to _state; false if it is not Pending any more.
+        bool Settle(Slot& _slot, uint32_t _generation, SlotState _state) noexcept;
+        std::expected<TaskResult, CThreaderError> Read(uint64_t _id, bool _take) noexcept;
+
+        std::array<std::atomic<Slot*>, kMaxChunks> m_chunks{};
+        alignas(64) std::atomic<uint64_t> m_freeHead{ 0 }; // tag << 32 | (index + 1)
+        alignas(64) std::atomic<uint64_t> m_nextIndex{ 0 };
+    };
+}
@@ -0,0 +1,49 @@
+#pragma once
+#include <array>
+#include <chrono>
+#include <cstdint>
+
+namespace CT {
+    // The policies share work out between three tiers of priority bands:
+    // Low (bands 0-21), Medium (22-42) and High (43-63), each holding its
+    // named TaskLevel. Within a tier the highest non-empty band always goes
+    // first, and StrictPriority runs band by band.
+    enum class SchedulingPolicy {
+        // High before Medium before Low. Lowest latency for High, but a steady
+        // stream of High tasks starves Low.
+        StrictPriority,
+        // Deficit round-robin: per round each level may run up to its weight in
+        // tasks, so every level with work gets a guaranteed share.
+        WeightedFair,
+        // Strict priority, except a level that has not been served for maxAge
+        // gets its next task ahead of the higher levels.
+        AgePromotion,
+        // Tasks enqueued with a deadline run earliest deadline first, ahead
+        // of every level; the levels then go in strict priority. Under the
+        // other policies a deadline is ignored and the task joins its level.
+        EarliestDeadline,
+    };
+
+    struct SchedulingOptions {
+        SchedulingPolicy policy{ SchedulingPolicy::WeightedFair };
+        // Tasks per round, indexed by tier: Low, Medium, High. 0 counts as 1.
+        std::array<uint32_t, 3> weights{ 1, 4, 8 };
+        std::chrono::microseconds maxAge{ 10'000 };
+        // EarliestDeadline: drop a task whose deadline passed before it
+        // started (its result reports DeadlineMissed) instead of running it late.
+        bool dropMissed{ false };
+    };
+
+    // Tasks taken from each tier since the pool was created, indexed Low,
+    // Medium, High. share is the effective service ratio (executed / total).
+    // Deadline tasks are counted apart from the levels.
+    struct SchedulingStats {
+        std::array<uint64_t, 3> executed{};
+        std::array<double, 3> share{};
+        // Deadline tasks finished in time, finished late or dropped
+        // (dropped ones also count as missed).
+        uint64_t deadlineMet{ 0 };
+        uint64_t deadlineMissed{ 0 };
+        uint64_t deadlineDropped{ 0 };
+    };
+}
@@ -0,0 +1,41 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <thread>
+
+#include "CpuRelax.hpp"
+#include "Metrics.hpp"
+
+namespace CT {
+    struct alignas(64) SpinLock {
+        std::atomic_flag flag = ATOMIC_FLAG_INIT;
+
+        void lock() noexcept {
+            uint32_t spins = 1;
+            uint64_t rounds = 0;
+            uint64_t yields = 0;
+            while (flag.test_and_set(std::memory_order_acquire)) {
+                for (uint32_t i = 0; i < spins; ++i) {
+                    CpuRelax();
+                }
+
+                spins = (spins < (1u << 12)) ? (spins << 1) : (1u << 12);
+                ++rounds;
+
+                if (spins == (1u << 12)) {
+                    std::this_thread::yield();
+                    ++yields;
+                }
+            }
+
+            if constexpr (kMetricsEnabled) {
+                if (rounds != 0) {
+                    Detail::RecordSpin(rounds, yields);
+                }
+            }
+        }
+        void unlock() noexcept {
+            flag.clear(std::memory_order_release);
+        }
+    };
+}
@@ -6,29 +6,154 @@
 #include <tuple>
 #include <type_traits>
 #include <utility>
+#include <cstddef>
+
+#include "TaskResult.hpp"
+#include "CancelToken.hpp"
+
+// Bytes of callable state a Task holds without touching the heap.
+#ifndef CTHREADER_TASK_INLINE_SIZE
+#define CTHREADER_TASK_INLINE_SIZE 48
+#endif
+
+// 1 makes the pool keep the counters behind CThreader::GetStats (see
+// Metrics.hpp); tasks then also carry the time they were pushed.
+#ifndef CTHREADER_ENABLE_METRICS
+#define CTHREADER_ENABLE_METRICS 0
+#endif
+
+// 1 compiles in the lifecycle tracing of Trace.hpp; tasks then carry the id
+// that links their events.
+#ifndef CTHREADER_ENABLE_TRACING
+#define CTHREADER_ENABLE_TRACING 0
+#endif
+
+// 1 has workers read hardware counters around every task (PerfCounters.hpp,
+// Linux only); tasks then carry the tag the counts are summed under.
+#ifndef CTHREADER_ENABLE_PERF_COUNTERS
+#define CTHREADER_ENABLE_PERF_COUNTERS 0
+#endif
 
 namespace CT {
-    enum class TaskLevel : uint64_t { Low = 0, Medium = 1, High = 2 };
+    // Number of priority bands a TaskLevel can name.
+    inline constexpr size_t kPriorityBands = 64;
+
+    // Priority band, 0 (lowest) to kPriorityBands - 1; values above that run
+    // in the top band. The named levels sit spread over the range, so any
+    // band in between is valid too: PriorityBand(40) runs after High and
+    // before Medium.
+    enum class TaskLevel : uint64_t { Low = 16, Medium = 32, High = 48 };
 
+    constexpr TaskLevel PriorityBand(size_t _band) noexcept {
+        return static_cast<TaskLevel>(_band < kPriorityBands ? _band : kPriorityBands - 1);
+    }
+
+    // Move-only type-erased callable. Captures up to kInlineSize bytes live
+    // inside the Task itself; larger ones (or ones whose move may throw) fall
+    // back to a single heap allocation. A callable whose first parameter is
+    // a CancelToken gets the pool's token for this task in it.
     class Task {
     public:
+        static constexpr size_t kInlineSize = CTHREADER_TASK_INLINE_SIZE;
+        // Id of a task that owns no result slot (Post, TaskHandle).
+        static constexpr uint64_t kNoResultId = 0;
+
         template<typename Callable, typename... Args>
+            requires (!std::is_same_v<std::remove_cvref_t<Callable>, Task>)
         Task(Callable&& func, Args&&... args) noexcept;
 
         Task() noexcept = default;
+        ~Task();
 
-        Task(Task&&) noexcept = default;
-        Task& operator=(Task&&) noexcept = default;
+        Task(Task&& _other) noexcept;
+        Task& operator=(Task&& _other) noexcept;
         Task(const Task&) = delete;
         Task& operator=(const Task&) = delete;
 
-        std::any Execute() const;
+        // Runs the callable; its return value is written to _result if given.
+        void Execute(TaskResult* _result = nullptr, const CancelToken& _token = {});
         void SetTaskId(uint64_t _taskId) noexcept;
         uint64_t GetTaskId() const noexcept;
+        explicit operator bool() const noexcept;
+
+        // steady_clock ticks at push, 0 if unknown; metrics builds only.
+        void SetQueuedAt([[maybe_unused]] int64_t _ticks) noexcept {
+#if CTHREADER_ENABLE_METRICS
+            m_queuedAt = _ticks;
+#endif
+        }
+        int64_t GetQueuedAt() const noexcept {
+#if CTHREADER_ENABLE_METRICS
+            return m_queuedAt;
+#else
+            return 0;
+#endif
+        }
+        // Links the trace events of one task; tracing builds only.
+        void SetTraceId([[maybe_unused]] uint64_t _id) noexcept {
+#if CTHREADER_ENABLE_TRACING
+            m_traceId = _id;
+#endif
+        }
+        uint64_t GetTraceId() const noexcept {
+#if CTHREADER_ENABLE_TRACING
+            return m_traceId;
+#else
+            return 0;
+#endif
+        }
+        // Slot of CThreader::GetPerfStats this task's counts go to, 0 for
+        // untagged; perf counter builds only.
+        void SetTag([[maybe_unused]] uint32_t _tag) noexcept {
+#if CTHREADER_ENABLE_PERF_COUNTERS
+            m_tag = _tag;
+#endif
+        }
+        uint32_t GetTag() const noexcept {
+#if CTHREADER_ENABLE_PERF_COUNTERS
+            return m_tag;
+#else
+            return 0;
+#endif
+        }
 
     private:
-        std::function<std::any()> m_task;
+        struct Ops {
+            void (*invoke)(void* _storage, TaskResult* _result, const CancelToken& _token);
+            void (*move)(void* _dst, void* _src) noexcept;
+            void (*destroy)(void* _storage) noexcept;
+        };
+
+        template<typename Callable, typename... Args>
+        struct BoundCall;
+
+        template<typename Fn>
+        static constexpr bool kFitsInline = sizeof(Fn) <= kInlineSize
+            && alignof(Fn) <= alignof(std::max_align_t)
+            && std::is_nothrow_move_constructible_v<Fn>;
+
+        template<typename Fn>
+        static void Invoke(Fn& _fn, TaskResult* _result, const CancelToken& _token);
+
+        template<typename Fn>
+        static const Ops kInlineOps;
+        template<typename Fn>
+        static const Ops kHeapOps;
+
+        void Reset() noexcept;
+
+        alignas(std::max_align_t) unsigned char m_storage[kInlineSize];
+        const Ops* m_ops{ nullptr };
         uint64_t m_taskId{ 0 };
+#if CTHREADER_ENABLE_METRICS
+        int64_t m_queuedAt{ 0 };
+#endif
+#if CTHREADER_ENABLE_TRACING
+        uint64_t m_traceId{ 0 };
+#endif
+#if CTHREADER_ENABLE_PERF_COUNTERS
+        uint32_t m_tag{ 0 };
+#endif
     };
 }
 
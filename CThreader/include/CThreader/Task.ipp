@@ -2,21 +2,82 @@
 #include <tuple>
 #include <type_traits>
 #include <utility>
+#include <new>
 
 namespace CT {
     template<typename Callable, typename... Args>
-    Task::Task(Callable&& func, Args&&... args) noexcept {
-        using ResultType = std::invoke_result_t<Callable, Args...>;
-        auto t_args = std::make_tuple(std::forward<Args>(args)...);
+    struct Task::BoundCall {
+        Callable fn;
+        std::tuple<Args...> args;
 
-        m_task = [fn = std::forward<Callable>(func), tuple = std::move(t_args)]() -> std::any {
-            if constexpr (std::is_void_v<ResultType>) {
-                std::apply(fn, tuple);
-                return std::any{};
+        decltype(auto) operator()(const CancelToken& _token) {
+            if constexpr (std::is_invocable_v<Callable&, const CancelToken&, Args&...>) {
+                return std::apply([&](Args&... _args) -> decltype(auto) { return fn(_token, _args...); }, args);
             }
             else {
-                return std::any(std::apply(fn, tuple));
+                return std::apply(fn, args);
+            }
+        }
+    };
+
+    template<typename Fn>
+    void Task::Invoke(Fn& _fn, TaskResult* _result, const CancelToken& _token) {
+        using ResultType = decltype(_fn(_token));
+        if constexpr (std::is_void_v<ResultType>) {
+            _fn(_token);
+            if (_result) {
+                _result->SetValue(std::any{});
             }
-        };
+        }
+        else if (_result) {
+            _result->Emplace(_fn(_token));
+        }
+        else {
+            (void)_fn(_token);
+        }
+    }
+
+    template<typename Fn>
+    const Task::Ops Task::kInlineOps = {
+        [](void* _storage, TaskResult* _result, const CancelToken& _token) {
+            Invoke(*std::launder(static_cast<Fn*>(_storage)), _result, _token);
+        },
+        [](void* _dst, void* _src) noexcept {
+            Fn* src = std::launder(static_cast<Fn*>(_src));
+            ::new (_dst) Fn(std::move(*src));
+            src->~Fn();
+        },
+        [](void* _storage) noexcept {
+            std::launder(static_cast<Fn*>(_storage))->~Fn();
+        }
+    };
+
+    template<typename Fn>
+    const Task::Ops Task::kHeapOps = {
+        [](void* _storage, TaskResult* _result, const CancelToken& _token) {
+            Invoke(**static_cast<Fn**>(_storage), _result, _token);
+        },
+        [](void* _dst, void* _src) noexcept {
+            *static_cast<Fn**>(_dst) = *static_cast<Fn**>(_src);
+        },
+        [](void* _storage) noexcept {
+            delete *static_cast<Fn**>(_storage);
+        }
+    };
+
+    template<typename Callable, typename... Args>
+        requires (!std::is_same_v<std::remove_cvref_t<Callable>, Task>)
+    Task::Task(Callable&& func, Args&&... args) noexcept {
+        using Fn = BoundCall<std::decay_t<Callable>, std::decay_t<Args>...>;
+        using Tuple = std::tuple<std::decay_t<Args>...>;
+
+        if constexpr (kFitsInline<Fn>) {
+            ::new (static_cast<void*>(m_storage)) Fn{ std::forward<Callable>(func), Tuple(std::forward<Args>(args)...) };
+            m_ops = &kInlineOps<Fn>;
+        }
+        else {
+            *reinterpret_cast<Fn**>(m_storage) = new Fn{ std::forward<Callable>(func), Tuple(std::forward<Args>(args)...) };
+            m_ops = &kHeapOps<Fn>;
+        }
     }
 }
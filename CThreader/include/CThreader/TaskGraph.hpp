@@ -0,0 +1,76 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <exception>
+#include <expected>
+#include <memory>
+#include <vector>
+
+#include "Task.hpp"
+#include "TaskHandle.hpp"
+#include "Utils.hpp"
+
+namespace CT {
+    class ThreadPool;
+
+    // Reusable DAG of tasks. Built once with Add/Precede, then run any number
+    // of times. Every node keeps an atomic count of unfinished predecessors;
+    // the task that brings it to zero queues the node, so no thread waits on
+    // an intermediate result. Node tasks run through Task::Execute on every
+    // run, so their captures must stay valid between runs.
+    class TaskGraph {
+    public:
+        using NodeId = uint32_t;
+
+        TaskGraph() noexcept = default;
+        // Must not be destroyed while a run is in flight.
+        ~TaskGraph() = default;
+
+        TaskGraph(const TaskGraph&) = delete;
+        TaskGraph& operator=(const TaskGraph&) = delete;
+
+        NodeId Add(Task&& _task, TaskLevel _taskLevel = TaskLevel::Low);
+        // _after starts only once _before has finished.
+        std::expected<void, CThreaderError> Precede(NodeId _before, NodeId _after);
+
+        size_t Size() const noexcept { return m_nodes.size(); }
+        bool IsRunning() const noexcept { return m_running.load(std::memory_order_acquire); }
+
+        // Queues the root nodes on _pool. The handle becomes ready after the
+        // last node; if a node throws, nodes that have not started are skipped
+        // and the handle carries the first error. Add/Precede must not be
+        // called while a run is in flight.
+        std::expected<TaskHandle<void>, CThreaderError> Run(ThreadPool& _pool);
+
+    private:
+        struct Node {
+            Task task;
+            TaskLevel level{ TaskLevel::Low };
+            std::vector<NodeId> successors;
+            uint32_t predecessors{ 0 };
+            std::atomic<uint32_t> pending{ 0 };
+        };
+
+        // Callable of a queued node; dropped without running, it retires
+        // the node so the run still finishes, with an error.
+        class NodeRun;
+
+        bool Validate();
+        void Schedule(NodeId _id) noexcept;
+        void Execute(NodeId _id) noexcept;
+        void Drop(NodeId _id) noexcept;
+        void Release(NodeId _id) noexcept;
+        void Finish() noexcept;
+
+        std::vector<std::unique_ptr<Node>> m_nodes;
+        std::vector<NodeId> m_roots;
+        bool m_validated{ false };
+
+        ThreadPool* m_pool{ nullptr };
+        std::shared_ptr<TaskState<void>> m_state;
+        std::exception_ptr m_error;
+        alignas(64) std::atomic<size_t> m_remaining{ 0 };
+        std::atomic<bool> m_failed{ false };
+        std::atomic<bool> m_running{ false };
+    };
+}
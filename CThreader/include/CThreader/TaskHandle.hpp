@@ -0,0 +1,436 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <exception>
+#include <memory>
+#include <optional>
+#include <span>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+
+#include "AtomicWait.hpp"
+
+namespace CT {
+    class TaskStateBase;
+
+    // Callback a TaskState runs once it completes. Nodes are heap allocated
+    // by whoever registers them and fire() is responsible for freeing them.
+    struct Continuation {
+        void (*fire)(Continuation* _self, TaskStateBase& _from) noexcept;
+        Continuation* next{ nullptr };
+    };
+
+    // Completion word, error slot and continuation list shared by every
+    // TaskState<T>; lets continuations and joins work on handles of any type.
+    class TaskStateBase {
+    public:
+        TaskStateBase() noexcept = default;
+        TaskStateBase(const TaskStateBase&) = delete;
+        TaskStateBase& operator=(const TaskStateBase&) = delete;
+
+        ~TaskStateBase() {
+            // Never completed (e.g. dropped by ClearTasks): dependents see an error.
+            Continuation* c = m_continuations.load(std::memory_order_acquire);
+            if (c && c != Done()) {
+                m_error = std::make_exception_ptr(std::runtime_error("Task was dropped before it completed."));
+            }
+            while (c && c != Done()) {
+                Continuation* next = c->next;
+                c->fire(c, *this);
+                c = next;
+            }
+        }
+
+        bool IsReady() const noexcept {
+            return m_word.load(std::memory_order_acquire) & kReady;
+        }
+
+        void Wait() noexcept {
+            uint32_t w = m_word.load(std::memory_order_acquire);
+            while (!(w & kReady)) {
+                if ((w & kWaiting) || m_word.compare_exchange_weak(w, w | kWaiting, std::memory_order_acq_rel)) {
+                    AtomicWait(m_word, w | kWaiting);
+                }
+                w = m_word.load(std::memory_order_acquire);
+            }
+        }
+
+        bool WaitFor(std::chrono::nanoseconds _timeout) noexcept {
+            const auto deadline = std::chrono::steady_clock::now() + _timeout;
+            uint32_t w = m_word.load(std::memory_order_acquire);
+            while (!(w & kReady)) {
+                const auto left = deadline - std::chrono::steady_clock::now();
+                if (left.count() <= 0) {
+                    return false;
+                }
+                if ((w & kWaiting) || m_word.compare_exchange_weak(w, w | kWaiting, std::memory_order_acq_rel)) {
+                    AtomicWaitFor(m_word, w | kWaiting, left);
+                }
+                w = m_word.load(std::memory_order_acquire);
+            }
+            return true;
+        }
+
+        // What the task threw; only meaningful once IsReady().
+        const std::exception_ptr& Error() const noexcept { return m_error; }
+
+        // Fires _node when this state completes, or right away if it already
+        // has. Lock-free; the completing thread runs the callbacks.
+        void AddContinuation(Continuation* _node) noexcept {
+            Continuation* head = m_continuations.load(std::memory_order_acquire);
+            do {
+                if (head == Done()) {
+                    _node->fire(_node, *this);
+                    return;
+                }
+                _node->next = head;
+            } while (!m_continuations.compare_exchange_weak(head, _node, std::memory_order_acq_rel, std::memory_order_acquire));
+        }
+
+    protected:
+        void Complete() noexcept {
+            // Only pay for the wake syscall when someone is actually parked.
+            if (m_word.exchange(kReady, std::memory_order_acq_rel) & kWaiting) {
+                AtomicNotifyAll(m_word);
+            }
+
+            Continuation* c = m_continuations.exchange(Done(), std::memory_order_acq_rel);
+            while (c) {
+                Continuation* next = c->next;
+                c->fire(c, *this);
+                c = next;
+            }
+        }
+
+        std::exception_ptr m_error;
+
+    private:
+        static constexpr uint32_t kReady = 1;
+        static constexpr uint32_t kWaiting = 2;
+
+        static Continuation* Done() noexcept {
+            static Continuation sentinel{ nullptr, nullptr };
+            return &sentinel;
+        }
+
+        alignas(64) std::atomic<uint32_t> m_word{ 0 };
+        std::atomic<Continuation*> m_continuations{ nullptr };
+    };
+
+    // Completion state shared between a running task and its TaskHandle.
+    template<typename T>
+    class TaskState : public TaskStateBase {
+    public:
+        template<typename Fn>
+        void Run(Fn&& _fn) noexcept {
+            try {
+                if constexpr (std::is_void_v<T>) {
+                    std::forward<Fn>(_fn)();
+                }
+                else {
+                    m_value.emplace(std::forward<Fn>(_fn)());
+                }
+            }
+            catch (...) {
+                m_error = std::current_exception();
+            }
+            Complete();
+        }
+
+        template<typename... Args>
+        void SetValue(Args&&... _args) noexcept(std::is_nothrow_constructible_v<std::conditional_t<std::is_void_v<T>, char, T>, Args...>) {
+            if constexpr (!std::is_void_v<T>) {
+                m_value.emplace(std::forward<Args>(_args)...);
+            }
+            Complete();
+        }
+
+        void SetException(std::exception_ptr _error) noexcept {
+            m_error = std::move(_error);
+            Complete();
+        }
+
+        // Blocks until ready, then reads the value in place (or rethrows).
+        // Continuations use this so several of them can share one result.
+        decltype(auto) Value() {
+            Wait();
+            if (m_error) {
+                std::rethrow_exception(m_error);
+            }
+            if constexpr (!std::is_void_v<T>) {
+                if (!m_value) {
+                    throw std::runtime_error("No value present in TaskHandle.");
+                }
+                return static_cast<const T&>(*m_value);
+            }
+        }
+
+        // Moves the value out, or copies it while continuations still read
+        // it in place; a type that cannot be copied waits for them instead.
+        T Take() {
+            Wait();
+            if (m_error) {
+                std::rethrow_exception(m_error);
+            }
+            if constexpr (!std::is_void_v<T>) {
+                if (!m_value) {
+                    throw std::runtime_error("No value present in TaskHandle.");
+                }
+                uint32_t r = m_readers.load(std::memory_order_acquire);
+                if constexpr (std::is_copy_constructible_v<T>) {
+                    if (r & ~kReaderWaiting) {
+                        return *m_value;
+                    }
+                }
+                while (r & ~kReaderWaiting) {
+                    if ((r & kReaderWaiting) || m_readers.compare_exchange_weak(r, r | kReaderWaiting, std::memory_order_acq_rel)) {
+                        AtomicWait(m_readers, r | kReaderWaiting);
+                    }
+                    r = m_readers.load(std::memory_order_acquire);
+                }
+                T v = std::move(*m_value);
+                m_value.reset();
+                return v;
+            }
+        }
+
+        // A continuation that will read the value through Value(); Take()
+        // leaves the value in place until every reader is released.
+        void AddReader() noexcept { m_readers.fetch_add(1, std::memory_order_relaxed); }
+        void ReleaseReader() noexcept {
+            if (m_readers.fetch_sub(1, std::memory_order_acq_rel) == (kReaderWaiting | 1)) {
+                AtomicNotifyAll(m_readers);
+            }
+        }
+
+    private:
+        static constexpr uint32_t kReaderWaiting = uint32_t(1) << 31;
+
+        std::optional<std::conditional_t<std::is_void_v<T>, char, T>> m_value;
+        std::atomic<uint32_t> m_readers{ 0 };
+    };
+
+    // Typed result of CThreader::Enqueue(level, fn, args...). Get() hands the
+    // value over directly, without std::any or the pool's result table.
+    template<typename T>
+    class TaskHandle {
+    public:
+        using ValueType = T;
+
+        TaskHandle() noexcept = default;
+        explicit TaskHandle(std::shared_ptr<TaskState<T>> _state) noexcept
+            : m_state(std::move(_state)) { }
+
+        bool Valid() const noexcept { return m_state != nullptr; }
+        bool IsReady() const noexcept { return m_state && m_state->IsReady(); }
+
+        void Wait() const noexcept {
+            if (m_state) {
+                m_state->Wait();
+            }
+        }
+
+        template<typename Rep, typename Period>
+        bool WaitFor(const std::chrono::duration<Rep, Period>& _timeout) const noexcept {
+            return m_state && m_state->WaitFor(std::chrono::duration_cast<std::chrono::nanoseconds>(_timeout));
+        }
+
+        // Blocks until the task finishes, then moves the result out (or
+        // rethrows what the task threw). The value can be taken only once.
+        T Get() {
+            if (!m_state) {
+                throw std::runtime_error("TaskHandle has no associated task.");
+            }
+            return m_state->Take();
+        }
+
+        const std::shared_ptr<TaskState<T>>& State() const noexcept { return m_state; }
+
+    private:
+        std::shared_ptr<TaskState<T>> m_state;
+    };
+
+    namespace Detail {
+        // The reference a queued task holds to the state it completes. If the
+        // task is destroyed without having run (ClearTasks, pool teardown),
+        // the state fails right then, so handles, joins and awaiting
+        // coroutines do not wait on a task that no longer exists.
+        template<typename T>
+        class StateOwner {
+        public:
+            explicit StateOwner(std::shared_ptr<TaskState<T>> _state) noexcept : m_state(std::move(_state)) {}
+
+            StateOwner(StateOwner&&) noexcept = default;
+            StateOwner& operator=(StateOwner&&) = delete;
+            StateOwner(const StateOwner&) = delete;
+            StateOwner& operator=(const StateOwner&) = delete;
+
+            ~StateOwner() {
+                if (m_state && !m_state->IsReady()) {
+                    m_state->SetException(std::make_exception_ptr(std::runtime_error("Task was dropped before it completed.")));
+                }
+            }
+
+            TaskState<T>* operator->() const noexcept { return m_state.get(); }
+
+        private:
+            std::shared_ptr<TaskState<T>> m_state;
+        };
+
+        // A queued continuation's hold on its predecessor's value: released
+        // when the continuation has run, or is dropped without running.
+        template<typename T>
+        class ValueReader {
+        public:
+            explicit ValueReader(std::shared_ptr<TaskState<T>> _state) noexcept : m_state(std::move(_state)) {}
+
+            ValueReader(ValueReader&&) noexcept = default;
+            ValueReader& operator=(ValueReader&&) = delete;
+            ValueReader(const ValueReader&) = delete;
+            ValueReader& operator=(const ValueReader&) = delete;
+
+            ~ValueReader() {
+                if constexpr (!std::is_void_v<T>) {
+                    if (m_state) {
+                        m_state->ReleaseReader();
+                    }
+                }
+            }
+
+            TaskState<T>* operator->() const noexcept { return m_state.get(); }
+
+        private:
+            std::shared_ptr<TaskState<T>> m_state;
+        };
+
+        template<typename T, typename Fn>
+        struct ThenResult { using type = std::decay_t<std::invoke_result_t<Fn&, const T&>>; };
+        template<typename Fn>
+        struct ThenResult<void, Fn> { using type = std::decay_t<std::invoke_result_t<Fn&>>; };
+
+        struct AllState {
+            TaskState<void> state;
+            std::atomic<size_t> pending{ 0 };
+            std::atomic<bool> failed{ false };
+            std::exception_ptr error;
+        };
+
+        struct AllNode : Continuation {
+            std::shared_ptr<AllState> join;
+        };
+
+        inline void FireAll(Continuation* _self, TaskStateBase& _from) noexcept {
+            auto* node = static_cast<AllNode*>(_self);
+            AllState& join = *node->join;
+            if (_from.Error() && !join.failed.exchange(true, std::memory_order_relaxed)) {
+                join.error = _from.Error();
+            }
+            if (join.pending.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+                if (join.error) {
+                    join.state.SetException(join.error);
+                }
+                else {
+                    join.state.SetValue();
+                }
+            }
+            delete node;
+        }
+
+        inline void WatchAll(const std::shared_ptr<AllState>& _join, TaskStateBase* _state) {
+            if (!_state) {
+                // Empty handle: nothing to wait for.
+                FireAll(new AllNode{ { &FireAll }, _join }, _join->state);
+                return;
+            }
+            _state->AddContinuation(new AllNode{ { &FireAll }, _join });
+        }
+
+        struct AnyState {
+            TaskState<size_t> state;
+            std::atomic<bool> done{ false };
+        };
+
+        struct AnyNode : Continuation {
+            std::shared_ptr<AnyState> join;
+            size_t index;
+        };
+
+        inline void FireAny(Continuation* _self, TaskStateBase& _from) noexcept {
+            auto* node = static_cast<AnyNode*>(_self);
+            AnyState& join = *node->join;
+            if (!join.done.exchange(true, std::memory_order_acq_rel)) {
+                if (_from.Error()) {
+                    join.state.SetException(_from.Error());
+                }
+                else {
+                    join.state.SetValue(node->index);
+                }
+            }
+            delete node;
+        }
+    }
+
+    // Ready once every handle is; fails with the first error any of them
+    // threw. Completion is driven by the last finishing task, so nothing
+    // blocks in between. Values stay in (and are read from) the inputs.
+    template<typename... Ts>
+    TaskHandle<void> WhenAll(const TaskHandle<Ts>&... _handles) {
+        auto join = std::make_shared<Detail::AllState>();
+        join->pending.store(sizeof...(Ts) + 1, std::memory_order_relaxed);
+        (Detail::WatchAll(join, _handles.State().get()), ...);
+        Detail::WatchAll(join, nullptr); // drops the guard count taken above
+        return TaskHandle<void>(std::shared_ptr<TaskState<void>>(join, &join->state));
+    }
+
+    template<typename T>
+    TaskHandle<void> WhenAll(std::span<const TaskHandle<T>> _handles) {
+        auto join = std::make_shared<Detail::AllState>();
+        join->pending.store(_handles.size() + 1, std::memory_order_relaxed);
+        for (const auto& handle : _handles) {
+            Detail::WatchAll(join, handle.State().get());
+        }
+        Detail::WatchAll(join, nullptr);
+        return TaskHandle<void>(std::shared_ptr<TaskState<void>>(join, &join->state));
+    }
+
+    // Ready with the position of the first handle to finish (or its error).
+    template<typename T>
+    TaskHandle<size_t> WhenAny(std::span<const TaskHandle<T>> _handles) {
+        auto join = std::make_shared<Detail::AnyState>();
+        TaskHandle<size_t> result(std::shared_ptr<TaskState<size_t>>(join, &join->state));
+        if (_handles.empty()) {
+            join->state.SetException(std::make_exception_ptr(std::invalid_argument("WhenAny needs at least one handle.")));
+            return result;
+        }
+
+        for (size_t i = 0; i < _handles.size() && !join->done.load(std::memory_order_acquire); ++i) {
+            auto* node = new Detail::AnyNode{ { &Detail::FireAny }, join, i };
+            if (TaskStateBase* state = _handles[i].State().get()) {
+                state->AddContinuation(node);
+            }
+            else {
+                Detail::FireAny(node, join->state);
+            }
+        }
+        return result;
+    }
+
+    template<typename... Ts>
+        requires (sizeof...(Ts) > 0)
+    TaskHandle<size_t> WhenAny(const TaskHandle<Ts>&... _handles) {
+        auto join = std::make_shared<Detail::AnyState>();
+        size_t i = 0;
+        const auto watch = [&](TaskStateBase* _state) {
+            auto* node = new Detail::AnyNode{ { &Detail::FireAny }, join, i++ };
+            if (_state) {
+                _state->AddContinuation(node);
+            }
+            else {
+                Detail::FireAny(node, join->state);
+            }
+        };
+        (watch(_handles.State().get()), ...);
+        return TaskHandle<size_t>(std::shared_ptr<TaskState<size_t>>(join, &join->state));
+    }
+}
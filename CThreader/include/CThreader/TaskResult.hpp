@@ -2,22 +2,83 @@
 #include <optional>
 #include <any>
 #include <stdexcept>
+#include <typeinfo>
+#include <type_traits>
+#include <cstring>
+#include <cstddef>
+#include <utility>
 
 namespace CT {
     class TaskResult {
     public:
+        // Trivially copyable results up to this size are stored inline and
+        // only boxed into std::any when read through GetValue/GetValueRef.
+        static constexpr size_t kInlineSize = 16;
+
         TaskResult(std::optional<std::any>&& v) noexcept;
         TaskResult() noexcept = default;
         ~TaskResult() = default;
+        TaskResult(const TaskResult&) = default;
+        TaskResult& operator=(const TaskResult&) = default;
+        TaskResult(TaskResult&&) noexcept = default;
+        TaskResult& operator=(TaskResult&&) noexcept = default;
 
         bool HasValue() const noexcept;
         void SetValue(std::any&& v) noexcept;
         std::any GetValue() const;
         const std::any& GetValueRef() const noexcept;
 
+        template<typename T>
+        void Emplace(T&& v);
+
+        // Typed access without std::any_cast; nullptr on type mismatch.
+        template<typename T>
+        const T* TryGet() const noexcept;
+
         explicit operator bool() const noexcept;
 
     private:
-        std::optional<std::any> m_value;
+        template<typename T>
+        static constexpr bool kStoredInline = std::is_trivially_copyable_v<T>
+            && sizeof(T) <= kInlineSize && alignof(T) <= alignof(std::max_align_t);
+
+        template<typename T>
+        static std::any Box(const void* _bytes) {
+            T v;
+            std::memcpy(&v, _bytes, sizeof(T));
+            return std::any(v);
+        }
+
+        mutable std::optional<std::any> m_value;
+        alignas(std::max_align_t) unsigned char m_inline[kInlineSize]{};
+        const std::type_info* m_inlineType{ nullptr };
+        std::any (*m_box)(const void*) { nullptr };
     };
+
+    template<typename T>
+    void TaskResult::Emplace(T&& v) {
+        using ValueType = std::decay_t<T>;
+        if constexpr (kStoredInline<ValueType> && std::is_default_constructible_v<ValueType>) {
+            const ValueType copy = v;
+            std::memcpy(m_inline, &copy, sizeof(ValueType));
+            m_inlineType = &typeid(ValueType);
+            m_box = &Box<ValueType>;
+            m_value.reset();
+        }
+        else {
+            m_value = std::any(std::forward<T>(v));
+            m_inlineType = nullptr;
+        }
+    }
+
+    template<typename T>
+    const T* TaskResult::TryGet() const noexcept {
+        if (m_inlineType) {
+            if constexpr (kStoredInline<T>) {
+                return *m_inlineType == typeid(T) ? reinterpret_cast<const T*>(m_inline) : nullptr;
+            }
+            return nullptr;
+        }
+        return m_value ? std::any_cast<T>(&*m_value) : nullptr;
+    }
 }
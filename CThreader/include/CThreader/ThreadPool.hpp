@@ -7,111 +7,301 @@
 #include <any>
 #include <expected>
 #include <atomic>
-#include <condition_variable>
 #include <array>
-#include <print>
+#include <span>
+#include <chrono>
+#include <condition_variable>
 
 #include "Task.hpp"
 #include "TaskResult.hpp"
+#include "CancelToken.hpp"
+#include "ResultStore.hpp"
+#include "Scheduling.hpp"
+#include "Metrics.hpp"
+#include "Trace.hpp"
+#include "PerfCounters.hpp"
+#include "ElasticOptions.hpp"
+#include "Topology.hpp"
+#include "TimerWheel.hpp"
 #include "Utils.hpp"
 #include "CpuRelax.hpp"
+#include "SpinLock.hpp"
+#include "AtomicWait.hpp"
+#include "MPMCQueue.hpp"
+#include "DeadlineQueue.hpp"
+#include "WorkStealingDeque.hpp"
 
 namespace CT {
-    struct alignas(64) SpinLock {
-        std::atomic_flag flag = ATOMIC_FLAG_INIT;
-
-        void lock() noexcept {
-            uint32_t spins = 1;
-            while (flag.test_and_set(std::memory_order_acquire)) {
-                for (uint32_t i = 0; i < spins; ++i) {
-                    CpuRelax();
-                }
+    class ThreadPool {
+    public:
+        ThreadPool() noexcept;
+        // Tasks still queued are dropped once the workers are joined, while
+        // the pool is whole, so their handles fail instead of hanging.
+        ~ThreadPool() noexcept {
+            Kill(CThreaderStopFlag::CLOSE_AFTER_COMPLETING_PROCESSED_TASKS);
+            ClearTasks();
+        }
 
-                spins = (spins < (1u << 12)) ? (spins << 1) : (1u << 12);
+        // Any node: workers push locally, other threads to their own node.
+        static constexpr size_t kAnyNode = static_cast<size_t>(-1);
 
-                if (spins == (1u << 12)) {
-                    std::this_thread::yield();
-                }
-            }
-        }
-        void unlock() noexcept {
-            flag.clear(std::memory_order_release);
-        }
-    };
+        // Starts _threadCount workers; with _elastic.maxThreads above that the
+        // pool grows under queue pressure and shrinks back when idle.
+        void Initialize(size_t _threadCount, TopologyMode _mode = TopologyMode::Flat, const ElasticOptions& _elastic = {}) noexcept;
+        // _node (an index below NodeCount()) routes the task to that node's
+        // queues; out-of-range values wrap.
+        void PushTask(Task&& _task, TaskLevel _taskLevel, size_t _node = kAnyNode) noexcept;
+        // Moves every task in one queue operation and wakes at most as many
+        // sleeping workers as there are tasks.
+        void PushTasks(std::span<Task> _tasks, TaskLevel _taskLevel, size_t _node = kAnyNode) noexcept;
+        // Under SchedulingPolicy::EarliestDeadline the task is ordered by
+        // _deadline ahead of all levels; otherwise this is PushTask.
+        void PushDeadlineTask(Task&& _task, TaskLevel _taskLevel, std::chrono::steady_clock::time_point _deadline) noexcept;
+        uint64_t ReserveResult();
+        // The id is cancelled along with _group.
+        uint64_t ReserveResult(const CancelGroup& _group);
+        void ReserveResults(std::span<uint64_t> _ids);
+        // A queued task is skipped when dequeued; a running one sees its
+        // CancelToken stop. False if it already finished or the id is stale.
+        bool CancelTask(uint64_t _taskId) noexcept;
+        std::expected<TaskResult, CThreaderError> GetResult(uint64_t _taskId) noexcept;
+        std::expected<TaskResult, CThreaderError> TakeResult(uint64_t _taskId) noexcept;
+        void Stop(const CThreaderStopFlag _flag) noexcept;
+        void Start() noexcept;
+        void Kill(const CThreaderStopFlag _flag) noexcept;
+        void ClearTasks() noexcept;
+        // Block until no task is queued or running (delayed tasks still in
+        // the timer wheel do not count). Not from inside a task of this pool.
+        void WaitIdle() noexcept;
+        // False if tasks were still outstanding after _timeout.
+        bool WaitIdleFor(std::chrono::steady_clock::duration _timeout) noexcept;
 
-    template<typename T>
-    class MPMCQueueLite {
-    public:
-        void push(T&& v) {
-            std::lock_guard<SpinLock> g(m_lock);
-            m_q.emplace_back(std::move(v));
-        }
+        size_t ThreadCount() const noexcept { return m_threadCount; }
+        // Workers currently running; moves between the elastic bounds.
+        size_t ActiveThreadCount() const noexcept { return m_active.load(std::memory_order_relaxed); }
+        ElasticOptions GetElastic() const noexcept { return m_elastic; }
+        // Queue sets in use: the NUMA node count in NumaAware mode, else 1.
+        size_t NodeCount() const noexcept { return m_queues.size(); }
+        const Topology& GetTopology() const noexcept { return m_topology; }
 
-        bool try_pop(T& out) {
-            std::lock_guard<SpinLock> g(m_lock);
-            if (m_q.empty()) {
-                return false;
-            }
+        // Safe to call while running; workers pick the change up on their
+        // next round.
+        void SetScheduling(const SchedulingOptions& _options) noexcept;
+        SchedulingOptions GetScheduling() const noexcept;
+        SchedulingStats GetSchedulingStats() const noexcept;
+        // Sums the per-worker metrics blocks; all zero unless built with
+        // CTHREADER_ENABLE_METRICS.
+        PoolStats GetStats() const;
+        // Sums the per-worker hardware counters by task tag; empty unless
+        // built with CTHREADER_ENABLE_PERF_COUNTERS.
+        PerfStats GetPerfStats() const;
+        // True when nothing in this band is waiting to be stolen from the
+        // calling thread, i.e. handing off more work would feed an idle worker.
+        bool ShouldSplit(TaskLevel _taskLevel) noexcept;
+        // Runs one queued task on the calling thread, worker or not. Lets a
+        // thread that blocks on a parallel loop help finish it.
+        bool RunPendingTask() noexcept;
+        // Brackets a stretch in which the calling worker waits on something
+        // other than the pool. While it lasts, a compensation worker may be
+        // started so the runnable thread count holds. Nests; no-ops off the
+        // pool's workers.
+        void BeginBlocking() noexcept;
+        void EndBlocking() noexcept;
 
-            out = std::move(m_q.front());
-            m_q.erase(m_q.begin());
-            return true;
-        }
+        // Queues _task at _taskLevel once _due has passed, and then every
+        // _interval if that is non-zero. Timers are kept in one wheel that a
+        // single pool thread services; they only fire while the pool runs.
+        TimerId AddTimer(Task&& _task, TaskLevel _taskLevel, std::chrono::steady_clock::time_point _due, std::chrono::steady_clock::duration _interval = {}) noexcept;
+        bool CancelTimer(TimerId _id) noexcept;
+    private:
+        static constexpr size_t kBandCount = kPriorityBands;
+        static_assert(kBandCount <= 64, "band occupancy is one 64-bit word");
+        // Scheduling policies and stats work on three tiers of bands (Low,
+        // Medium, High thirds of the range); within a tier the highest
+        // non-empty band goes first.
+        static constexpr size_t kTierCount = 3;
 
-        bool empty() const {
-            std::lock_guard<SpinLock> g(m_lock);
-            return m_q.empty();
+        static constexpr size_t TierOf(size_t _band) noexcept {
+            return _band * kTierCount / kBandCount;
         }
 
-        void reserve(size_t n) {
-            m_q.reserve(n);
+        static constexpr uint64_t TierMask(size_t _tier) noexcept {
+            uint64_t mask = 0;
+            for (size_t band = 0; band < kBandCount; ++band) {
+                if (TierOf(band) == _tier) {
+                    mask |= uint64_t(1) << band;
+                }
+            }
+            return mask;
         }
 
-    private:
-        mutable SpinLock m_lock;
-        std::vector<T> m_q;
-    };
+        // Shared FIFO queues of one NUMA node (the only set in Flat mode),
+        // one per band. Bit b of occupied is set while band b may hold tasks:
+        // producers set it after pushing, a consumer that finds the band
+        // empty clears it and puts it back if a push slipped in.
+        struct QueueSet {
+            std::array<MPMCQueue<Task>, kBandCount> bands;
+            alignas(64) std::atomic<uint64_t> occupied{ 0 };
+        };
 
-    class ThreadPool {
-    public:
-        ThreadPool() noexcept;
-        ~ThreadPool() noexcept { Kill(CThreaderStopFlag::CLOSE_AFTER_COMPLETING_PROCESSED_TASKS); };
+        struct alignas(64) Worker {
+            ~Worker();
 
-        void Initialize(size_t _threadCount) noexcept;
-        void PushTask(Task&& _task, TaskLevel _taskLevel) noexcept;
-        std::expected<TaskResult, CThreaderError> GetResult(uint64_t _taskId) noexcept;
-        void Stop(const CThreaderStopFlag _flag) noexcept;
-        void Start() noexcept;
-        void Kill(const CThreaderStopFlag _flag) noexcept;
-        void ClearTasks() noexcept;
-    private:
-        void WorkerLoop(std::stop_token _st);
+            // Tasks enqueued from inside a running task, one deque per band.
+            std::array<WorkStealingDeque<Task*>, kBandCount> local;
+            // Bands whose deque may be non-empty. Owner-written only: set on
+            // push, cleared when its own pop finds the band empty; thieves
+            // only read it.
+            std::atomic<uint64_t> localBits{ 0 };
+            uint64_t rng{ 0 };
+            size_t node{ 0 };
+            std::optional<uint32_t> cpu;
+            // Weighted-fair credit left in the current round, per tier.
+            std::array<uint32_t, kTierCount> credit{};
+            // Owner-written only; atomic so GetSchedulingStats can read them.
+            std::array<std::atomic<uint64_t>, kTierCount> served{};
+            // 1 while parked; whoever flips it back to 0 owns the wakeup.
+            alignas(64) std::atomic<uint32_t> parked{ 0 };
+            // A thread is running in this slot. Cleared by the thread itself
+            // when it retires, set by whoever refills the slot.
+            std::atomic<bool> active{ false };
+            // Inside a BlockingRegion; the watchdog leaves it alone.
+            std::atomic<bool> blocking{ false };
+            // steady_clock ticks when the current task started, 0 between
+            // tasks. Only kept up while the watchdog runs.
+            std::atomic<int64_t> busySince{ 0 };
+            // Deadline of the task FindTask just returned, 0 for level tasks.
+            int64_t deadline{ 0 };
+            // Band of that task, kBandCount for a deadline task; metrics only.
+            size_t band{ 0 };
+            Detail::MetricsBlock metrics;
+            Detail::PerfBlock perf;
+            // Owner-written deadline outcomes, summed by GetSchedulingStats.
+            std::atomic<uint64_t> deadlineMet{ 0 };
+            std::atomic<uint64_t> deadlineMissed{ 0 };
+            std::atomic<uint64_t> deadlineDropped{ 0 };
+        };
+
+        void WorkerLoop(std::stop_token _st, size_t _index);
+        bool SpinForTask(Worker& _self, Task& _out) noexcept;
+        // Returns true when the worker retired and its thread must exit.
+        bool Park(Worker& _self, const std::stop_token& _st) noexcept;
+        bool TryRetire(Worker& _self) noexcept;
+        void MonitorLoop(std::stop_token _st);
+        bool AddWorker();
+        bool Compensate() noexcept;
+        bool HasSurplus() const noexcept;
+        bool RetireSurplus(Worker& _self) noexcept;
+        size_t CountStalled() const noexcept;
+        void TimerLoop(std::stop_token _st);
+        void RearmTimer(TimerId _id) noexcept;
+        uint64_t TimerTick(std::chrono::steady_clock::time_point _time, bool _roundUp) const noexcept;
+        void LaunchWorker(size_t _index);
+        size_t QueuedTaskCount() const noexcept;
+        // Unparks up to _count workers; free when nobody is parked.
+        void WakeWorkers(size_t _count) noexcept;
+        void WakeAll() noexcept;
+        bool FindTask(Worker& _self, Task& _out) noexcept;
+        bool TakeTier(Worker& _self, size_t _tier, Task& _out) noexcept;
+        bool TakeBand(Worker& _self, size_t _band, Task& _out) noexcept;
+        // Highest band in _mask with work, found from the bitmaps.
+        bool TakeMasked(Worker& _self, uint64_t _mask, Task& _out) noexcept;
+        bool FindStrict(Worker& _self, Task& _out) noexcept;
+        bool FindWeighted(Worker& _self, Task& _out) noexcept;
+        bool FindAged(Worker& _self, Task& _out) noexcept;
+        bool TakeDeadline(Worker& _self, Task& _out) noexcept;
+        // RunTask plus the deadline bookkeeping for what FindTask returned.
+        void RunFound(Worker& _self, Task& _task) noexcept;
+        bool TakeShared(uint64_t& _rng, const Worker* _self, size_t _home, size_t _band, Task& _out) noexcept;
+        bool TrySteal(uint64_t& _rng, const Worker* _self, const std::vector<size_t>& _victims, size_t _band, Task& _out) noexcept;
+        // Bands that may hold work outside _self: every node's global queues
+        // plus the steal hint.
+        uint64_t SharedBits() const noexcept;
+        void PushLocal(Worker& _self, size_t _band, Task&& _task);
+        void PushGlobal(size_t _node, size_t _band, Task* _tasks, size_t _count);
+        bool PopGlobal(size_t _node, size_t _band, Task& _out) noexcept;
+        void MarkStealable(size_t _band) noexcept;
+        void DropStealHint(size_t _band) noexcept;
+        size_t LocalNode() const noexcept;
+        void BuildQueues(size_t _nodeCount);
+        void RunTask(Task& _task) noexcept;
+        // _count tasks left the pool, run or dropped.
+        void TaskDone(size_t _count) noexcept;
+        bool WaitForIdle(std::optional<std::chrono::steady_clock::time_point> _until) noexcept;
+        bool HasQueuedTasks() const noexcept;
+        MPMCQueue<Task>& GlobalQueue(size_t _node, size_t _band) noexcept;
 
         size_t m_threadCount{ 0 };
+        TopologyMode m_mode{ TopologyMode::Flat };
+        Topology m_topology;
+        // Set by Initialize so Start rebuilds the workers for the new layout.
+        bool m_layoutChanged{ true };
+        // Fixed between Initialize calls. Worker slots are allocated up to
+        // maxThreads at Start, so growing never moves a Worker under a thief.
+        ElasticOptions m_elastic;
+        alignas(64) std::atomic<size_t> m_active{ 0 };
+        // Workers in a BlockingRegion, workers the watchdog caught (written
+        // by the monitor only), and compensation workers started for them.
+        std::atomic<size_t> m_blocked{ 0 };
+        std::atomic<size_t> m_stalled{ 0 };
+        std::atomic<size_t> m_compensating{ 0 };
 
-        MPMCQueueLite<Task> m_qHigh;
-        MPMCQueueLite<Task> m_qMedium;
-        MPMCQueueLite<Task> m_qLow;
+        std::vector<std::unique_ptr<QueueSet>> m_queues;
+        // Worker indices per node, parallel to m_queues.
+        std::vector<std::vector<size_t>> m_nodeWorkers;
 
-        std::mutex m_sleepMx;
-        std::condition_variable m_cv;
+        // Parked workers. Producers read it after publishing a task and only
+        // then pay for a wakeup.
+        alignas(64) std::atomic<size_t> m_sleepers{ 0 };
+        // Tasks pushed and not yet finished or dropped: raised before the
+        // push, lowered once RunTask is through.
+        alignas(64) std::atomic<size_t> m_outstanding{ 0 };
+        // Bumped when m_outstanding reaches zero with someone in WaitIdle.
+        std::atomic<uint32_t> m_idleEpoch{ 0 };
+        std::atomic<uint32_t> m_idleWaiters{ 0 };
 
-        static constexpr size_t kShardCount = 64;
-        struct Shard {
-            SpinLock lock;
-        };
-        std::array<Shard, kShardCount> m_resultShards;
+        ResultStore m_results;
 
-        std::mutex m_resultsGrowMx;
-        std::vector<TaskResult> m_results;
-        std::atomic<uint64_t> m_resultsSize{ 0 };
+        // Bands any worker's deque may hold, so thieves know where to look
+        // without reading every worker. Set by owners on push, cleared by a
+        // worker that found a band empty everywhere; a stale bit costs a look.
+        alignas(64) std::atomic<uint64_t> m_stealBits{ 0 };
 
-        std::vector<std::jthread> m_threads;
+        std::atomic<SchedulingPolicy> m_policy{ SchedulingPolicy::WeightedFair };
+        std::array<std::atomic<uint32_t>, kTierCount> m_weights{};
+        std::atomic<int64_t> m_maxAge{ 0 };
+        // steady_clock ticks of the last task taken per tier (AgePromotion).
+        std::array<std::atomic<int64_t>, kTierCount> m_lastServed{};
+        // Tasks run by non-worker threads through RunPendingTask.
+        std::array<std::atomic<uint64_t>, kTierCount> m_helperServed{};
+        // Metrics of threads outside the pool: helpers and producers.
+        Detail::MetricsBlock m_externalMetrics{ true };
+        Detail::PerfBlock m_externalPerf{ true };
+        std::atomic<bool> m_dropMissed{ false };
+        // Deadline tasks (steady_clock ticks), one shard per hardware thread.
+        DeadlineQueue<Task> m_deadlines{ std::clamp<size_t>(std::thread::hardware_concurrency(), 1, 64) };
 
-        static constexpr size_t ShardOf(uint64_t id) noexcept {
-            return (id * 11400714819323198485ull) & (kShardCount - 1); // Fibonacci
-        }
+        // Timer wheel in kTimerTick steps counted from m_timerEpoch. The timer
+        // thread sleeps until the wheel's next expiry; an earlier timer
+        // wakes it through m_timerKick.
+        static constexpr std::chrono::milliseconds kTimerTick{ 1 };
+        TimerWheel m_timers;
+        std::mutex m_timerMutex;
+        std::condition_variable_any m_timerCv;
+        std::chrono::steady_clock::time_point m_timerEpoch{ std::chrono::steady_clock::now() };
+        uint64_t m_timerDeadline{ UINT64_MAX };
+        bool m_timerKick{ false };
+        bool m_timersEnabled{ false };
+        std::jthread m_timerThread;
 
-        void EnsureResultCapacity(uint64_t id);
+        std::vector<std::unique_ptr<Worker>> m_workers;
+        // One entry per worker slot; a retired slot keeps its finished thread
+        // until AddWorker reuses it or Kill joins it. Guarded by m_threadsMutex
+        // once the monitor runs.
+        std::vector<std::jthread> m_threads;
+        std::mutex m_threadsMutex;
+        // Set by Stop under m_threadsMutex; no worker is started after it.
+        bool m_stopped{ false };
+        std::jthread m_monitor;
     };
 }
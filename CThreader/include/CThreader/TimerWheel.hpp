@@ -0,0 +1,94 @@
+#pragma once
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <vector>
+
+#include "Task.hpp"
+
+namespace CT {
+    // Identifies a pending timer; 0 is never handed out.
+    using TimerId = uint64_t;
+
+    // Hierarchical timing wheel over abstract ticks: kLevels wheels of kSlots
+    // slots, each level kSlots times coarser than the one below. Entries sit
+    // in intrusive lists, so adding and cancelling are O(1); an entry moves
+    // down a level when its slot comes round, and fires from level 0. Due
+    // ticks past the top level's range park in its furthest slot and are
+    // placed again when it cascades. Not thread-safe; the owner locks.
+    class TimerWheel {
+    public:
+        static constexpr uint32_t kBits = 6;
+        static constexpr uint32_t kSlots = 1u << kBits;
+        static constexpr uint32_t kLevels = 4;
+
+        struct Fired {
+            // One-shot: the task itself. Periodic: empty, and periodic holds
+            // the shared task; the owner calls Rearm once that run is over.
+            Task task;
+            std::shared_ptr<Task> periodic;
+            TimerId id{ 0 };
+            TaskLevel level{ TaskLevel::Low };
+        };
+
+        // _interval 0 makes a one-shot timer. Due ticks not after the
+        // current tick fire on the next one.
+        TimerId Add(Task&& _task, TaskLevel _taskLevel, uint64_t _due, uint64_t _interval);
+        // False if the timer already fired (one-shot) or was cancelled.
+        bool Cancel(TimerId _id) noexcept;
+        // Puts a fired periodic timer back for its next period; runs that
+        // were missed are skipped, not bunched up. False once cancelled.
+        bool Rearm(TimerId _id, uint64_t _now) noexcept;
+        // Moves the wheel to _now and appends every timer due by then.
+        void Advance(uint64_t _now, std::vector<Fired>& _out);
+        // Earliest tick at which Advance has work to do (a fire or a cascade).
+        std::optional<uint64_t> NextExpiry() const noexcept;
+        void Clear() noexcept;
+
+        // Timers that can still fire, including periodic ones mid-run.
+        size_t Size() const noexcept { return m_live; }
+        uint64_t Now() const noexcept { return m_now; }
+
+    private:
+        static constexpr uint32_t kNil = UINT32_MAX;
+
+        enum class State : uint8_t { Free, Pending, Running };
+
+        struct Entry {
+            Task task;
+            std::shared_ptr<Task> periodic;
+            uint64_t due{ 0 };
+            uint64_t interval{ 0 };
+            TaskLevel level{ TaskLevel::Low };
+            uint32_t prev{ kNil };
+            uint32_t next{ kNil };
+            uint32_t generation{ 0 };
+            uint16_t slot{ 0 };
+            State state{ State::Free };
+        };
+
+        Entry* Find(TimerId _id) noexcept;
+        void Link(uint32_t _index) noexcept;
+        void Unlink(uint32_t _index) noexcept;
+        void Free(uint32_t _index) noexcept;
+        void Cascade(uint32_t _level) noexcept;
+        void Expire(std::vector<Fired>& _out);
+        static TimerId MakeId(uint32_t _index, uint32_t _generation) noexcept;
+
+        std::vector<Entry> m_entries;
+        std::vector<uint32_t> m_free;
+        std::array<uint32_t, kLevels * kSlots> m_heads = MakeHeads();
+        // Bit s of m_occupied[l] is set while slot s of level l is non-empty.
+        std::array<uint64_t, kLevels> m_occupied{};
+        uint64_t m_now{ 0 };
+        size_t m_linked{ 0 };
+        size_t m_live{ 0 };
+
+        static constexpr std::array<uint32_t, kLevels * kSlots> MakeHeads() noexcept {
+            std::array<uint32_t, kLevels * kSlots> heads{};
+            heads.fill(kNil);
+            return heads;
+        }
+    };
+}
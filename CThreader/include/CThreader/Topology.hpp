@@ -0,0 +1,42 @@
+#pragma once
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+namespace CT {
+    enum class TopologyMode {
+        // Unpinned workers sharing one set of queues (the default).
+        Flat,
+        // One worker per usable CPU pinned to it, one queue set per NUMA node,
+        // and stealing that stays inside the node before crossing it.
+        NumaAware,
+    };
+
+    struct NumaNode {
+        uint32_t id{ 0 };
+        std::vector<uint32_t> cpus;
+    };
+
+    // Processor layout as seen by this process. Read from /sys/devices/system
+    // on Linux (limited to the process affinity mask) and from the NUMA API on
+    // Windows; nodes without CPUs are dropped. Anywhere else, or when that
+    // fails, it is empty and callers treat the machine as a single node.
+    class Topology {
+    public:
+        static Topology Discover() noexcept;
+
+        const std::vector<NumaNode>& Nodes() const noexcept { return m_nodes; }
+        size_t NodeCount() const noexcept { return m_nodes.empty() ? 1 : m_nodes.size(); }
+        size_t CpuCount() const noexcept;
+        // Index into Nodes() of the node owning _cpu; 0 if unknown.
+        size_t NodeOfCpu(uint32_t _cpu) const noexcept;
+
+        static std::optional<uint32_t> CurrentCpu() noexcept;
+        static bool PinCurrentThread(uint32_t _cpu) noexcept;
+
+    private:
+        std::vector<NumaNode> m_nodes;
+        // cpu -> node index, for NodeOfCpu.
+        std::vector<uint32_t> m_cpuNode;
+    };
+}
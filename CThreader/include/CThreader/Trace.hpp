@@ -0,0 +1,75 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+
+#include "Task.hpp"
+
+// CTHREADER_ENABLE_TRACING (default 0, set in Task.hpp) compiles the task
+// lifecycle hooks in. Even then nothing is recorded until StartTracing, and
+// each hook is one relaxed load while tracing is off.
+
+namespace CT {
+    inline constexpr bool kTracingEnabled = CTHREADER_ENABLE_TRACING != 0;
+
+    // Starts recording enqueue, dequeue, start and finish events of every
+    // pool's tasks. Each thread writes to its own ring of _eventsPerThread
+    // events (rounded up to a power of two), overwriting its oldest ones. A
+    // ring outlives its thread and is taken over by the next thread in the
+    // same worker slot (or the next non-worker thread), so memory stays
+    // bounded by the threads alive at once however long it runs and however
+    // often elastic workers come and go. Restarting drops what was
+    // recorded before. Does nothing without CTHREADER_ENABLE_TRACING.
+    void StartTracing(size_t _eventsPerThread = size_t(1) << 15);
+    void StopTracing() noexcept;
+    // Writes what the rings hold as Chrome trace event JSON, which
+    // chrome://tracing and ui.perfetto.dev open. Safe while tracing runs;
+    // events being overwritten meanwhile are left out. False if the file
+    // could not be written.
+    bool WriteTrace(const std::filesystem::path& _path);
+
+    namespace Detail {
+        enum class TraceEvent : uint8_t { Enqueue, Dequeue, Start, Finish };
+
+#if CTHREADER_ENABLE_TRACING
+        inline std::atomic<bool> g_tracing{ false };
+
+        void TraceRecord(TraceEvent _event, uint64_t _traceId, uint64_t _taskId, uint32_t _level) noexcept;
+        uint64_t TraceNextId() noexcept;
+        // Names the calling thread "worker _index" in the trace.
+        void TraceSetWorker(uint32_t _index) noexcept;
+
+        inline bool Tracing() noexcept {
+            return g_tracing.load(std::memory_order_relaxed);
+        }
+#else
+        inline void TraceRecord(TraceEvent, uint64_t, uint64_t, uint32_t) noexcept {}
+        inline uint64_t TraceNextId() noexcept { return 0; }
+        inline void TraceSetWorker(uint32_t) noexcept {}
+        inline bool Tracing() noexcept { return false; }
+#endif
+
+        // Gives _task its trace id and records its push.
+        inline void TraceEnqueue(Task& _task, uint32_t _level) noexcept {
+            if constexpr (kTracingEnabled) {
+                if (Tracing()) {
+                    _task.SetTraceId(TraceNextId());
+                    TraceRecord(TraceEvent::Enqueue, _task.GetTraceId(), _task.GetTaskId(), _level);
+                }
+            }
+        }
+
+        // _level may be kTraceSameLevel for Start and Finish: the thread's
+        // last Dequeue supplies it.
+        inline constexpr uint32_t kTraceSameLevel = UINT32_MAX;
+
+        inline void Trace(TraceEvent _event, uint64_t _traceId, uint64_t _taskId, uint32_t _level = kTraceSameLevel) noexcept {
+            if constexpr (kTracingEnabled) {
+                if (Tracing()) {
+                    TraceRecord(_event, _traceId, _taskId, _level);
+                }
+            }
+        }
+    }
+}
@@ -4,6 +4,11 @@ namespace CT {
 	enum class CThreaderError {
 		CThreaderNotInitialized,
 		TaskNotFound,
+		TaskFailed,
+		GraphAlreadyRunning,
+		GraphHasCycle,
+		DeadlineMissed,
+		TaskCancelled,
 	};
 
 	enum class CThreaderStopFlag {
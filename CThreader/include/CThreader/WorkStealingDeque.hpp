@@ -0,0 +1,126 @@
+#pragma once
+#include <atomic>
+#include <memory>
+#include <vector>
+#include <cstdint>
+#include <type_traits>
+
+namespace CT {
+    // Chase-Lev work-stealing deque (Le et al., "Correct and Efficient
+    // Work-Stealing for Weak Memory Models"). The owning thread pushes and pops
+    // at the bottom, any other thread steals from the top. T must be trivially
+    // copyable because a thief reads a slot before it knows it won the race.
+    template<typename T>
+    class WorkStealingDeque {
+        static_assert(std::is_trivially_copyable_v<T>, "WorkStealingDeque stores trivially copyable values (e.g. pointers)");
+
+    public:
+        explicit WorkStealingDeque(size_t _capacity = 32) {
+            size_t cap = 2;
+            while (cap < _capacity) {
+                cap <<= 1;
+            }
+            m_buffers.emplace_back(std::make_unique<Buffer>(cap));
+            m_buffer.store(m_buffers.back().get(), std::memory_order_relaxed);
+        }
+
+        WorkStealingDeque(const WorkStealingDeque&) = delete;
+        WorkStealingDeque& operator=(const WorkStealingDeque&) = delete;
+
+        // Owner only.
+        void push(T v) {
+            const int64_t b = m_bottom.load(std::memory_order_relaxed);
+            const int64_t t = m_top.load(std::memory_order_acquire);
+            Buffer* a = m_buffer.load(std::memory_order_relaxed);
+            if (b - t > static_cast<int64_t>(a->mask)) {
+                a = Grow(a, t, b);
+            }
+            a->put(b, v);
+            m_bottom.store(b + 1, std::memory_order_release);
+        }
+
+        // Owner only, LIFO.
+        bool pop(T& out) {
+            const int64_t b = m_bottom.load(std::memory_order_relaxed) - 1;
+            Buffer* a = m_buffer.load(std::memory_order_relaxed);
+            m_bottom.store(b, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            int64_t t = m_top.load(std::memory_order_relaxed);
+
+            if (t > b) {
+                m_bottom.store(b + 1, std::memory_order_relaxed);
+                return false;
+            }
+
+            out = a->get(b);
+            if (t == b) {
+                // Last element: race the thieves for it.
+                const bool won = m_top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+                m_bottom.store(b + 1, std::memory_order_relaxed);
+                return won;
+            }
+            return true;
+        }
+
+        // Any thread, FIFO. May fail spuriously when racing other thieves.
+        bool steal(T& out) {
+            int64_t t = m_top.load(std::memory_order_acquire);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            const int64_t b = m_bottom.load(std::memory_order_acquire);
+            if (t >= b) {
+                return false;
+            }
+
+            Buffer* a = m_buffer.load(std::memory_order_acquire);
+            T v = a->get(t);
+            if (!m_top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+                return false;
+            }
+            out = v;
+            return true;
+        }
+
+        size_t size() const noexcept {
+            const int64_t b = m_bottom.load(std::memory_order_relaxed);
+            const int64_t t = m_top.load(std::memory_order_relaxed);
+            return b > t ? static_cast<size_t>(b - t) : 0;
+        }
+
+        bool empty() const noexcept {
+            return size() == 0;
+        }
+
+    private:
+        struct Buffer {
+            explicit Buffer(size_t _capacity)
+                : mask(_capacity - 1), slots(new std::atomic<T>[_capacity]) {}
+
+            void put(int64_t i, T v) noexcept {
+                slots[static_cast<size_t>(i) & mask].store(v, std::memory_order_relaxed);
+            }
+            T get(int64_t i) const noexcept {
+                return slots[static_cast<size_t>(i) & mask].load(std::memory_order_relaxed);
+            }
+
+            const size_t mask;
+            std::unique_ptr<std::atomic<T>[]> slots;
+        };
+
+        Buffer* Grow(Buffer* a, int64_t t, int64_t b) {
+            auto bigger = std::make_unique<Buffer>((a->mask + 1) * 2);
+            for (int64_t i = t; i < b; ++i) {
+                bigger->put(i, a->get(i));
+            }
+            // Old buffers stay alive: a thief may still be reading from them.
+            m_buffers.emplace_back(std::move(bigger));
+            Buffer* fresh = m_buffers.back().get();
+            m_buffer.store(fresh, std::memory_order_release);
+            return fresh;
+        }
+
+        alignas(64) std::atomic<int64_t> m_top{ 0 };
+        alignas(64) std::atomic<int64_t> m_bottom{ 0 };
+        alignas(64) std::atomic<Buffer*> m_buffer{ nullptr };
+        std::vector<std::unique_ptr<Buffer>> m_buffers;
+    };
+}
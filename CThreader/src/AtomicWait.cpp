@@ -0,0 +1,104 @@
+#include "CThreader/AtomicWait.hpp"
+#include <climits>
+#include <thread>
+
+#if defined(_WIN32)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#pragma comment(lib, "Synchronization.lib")
+#elif defined(__linux__)
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <ctime>
+#endif
+
+namespace CT {
+    static_assert(sizeof(std::atomic<uint32_t>) == sizeof(uint32_t), "futex word must be a plain 32-bit integer");
+
+#if defined(_WIN32)
+    void AtomicWait(std::atomic<uint32_t>& _word, uint32_t _old) noexcept {
+        while (_word.load(std::memory_order_acquire) == _old) {
+            WaitOnAddress(&_word, &_old, sizeof(_old), INFINITE);
+        }
+    }
+
+    bool AtomicWaitFor(std::atomic<uint32_t>& _word, uint32_t _old, std::chrono::nanoseconds _timeout) noexcept {
+        const auto deadline = std::chrono::steady_clock::now() + _timeout;
+        while (_word.load(std::memory_order_acquire) == _old) {
+            const auto left = std::chrono::ceil<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now());
+            if (left.count() <= 0) {
+                return false;
+            }
+            WaitOnAddress(&_word, &_old, sizeof(_old), static_cast<DWORD>(left.count()));
+        }
+        return true;
+    }
+
+    void AtomicNotifyOne(std::atomic<uint32_t>& _word) noexcept {
+        WakeByAddressSingle(&_word);
+    }
+
+    void AtomicNotifyAll(std::atomic<uint32_t>& _word) noexcept {
+        WakeByAddressAll(&_word);
+    }
+#elif defined(__linux__)
+    static long Futex(std::atomic<uint32_t>& _word, int _op, uint32_t _val, const timespec* _timeout) noexcept {
+        return syscall(SYS_futex, reinterpret_cast<uint32_t*>(&_word), _op | FUTEX_PRIVATE_FLAG, _val, _timeout, nullptr, 0);
+    }
+
+    void AtomicWait(std::atomic<uint32_t>& _word, uint32_t _old) noexcept {
+        while (_word.load(std::memory_order_acquire) == _old) {
+            Futex(_word, FUTEX_WAIT, _old, nullptr);
+        }
+    }
+
+    bool AtomicWaitFor(std::atomic<uint32_t>& _word, uint32_t _old, std::chrono::nanoseconds _timeout) noexcept {
+        const auto deadline = std::chrono::steady_clock::now() + _timeout;
+        while (_word.load(std::memory_order_acquire) == _old) {
+            const auto left = deadline - std::chrono::steady_clock::now();
+            if (left.count() <= 0) {
+                return false;
+            }
+            timespec ts{};
+            ts.tv_sec = static_cast<time_t>(std::chrono::duration_cast<std::chrono::seconds>(left).count());
+            ts.tv_nsec = static_cast<long>((left - std::chrono::seconds(ts.tv_sec)).count());
+            Futex(_word, FUTEX_WAIT, _old, &ts);
+        }
+        return true;
+    }
+
+    void AtomicNotifyOne(std::atomic<uint32_t>& _word) noexcept {
+        Futex(_word, FUTEX_WAKE, 1, nullptr);
+    }
+
+    void AtomicNotifyAll(std::atomic<uint32_t>& _word) noexcept {
+        Futex(_word, FUTEX_WAKE, INT_MAX, nullptr);
+    }
+#else
+    void AtomicWait(std::atomic<uint32_t>& _word, uint32_t _old) noexcept {
+        _word.wait(_old, std::memory_order_acquire);
+    }
+
+    bool AtomicWaitFor(std::atomic<uint32_t>& _word, uint32_t _old, std::chrono::nanoseconds _timeout) noexcept {
+        const auto deadline = std::chrono::steady_clock::now() + _timeout;
+        while (_word.load(std::memory_order_acquire) == _old) {
+            if (std::chrono::steady_clock::now() >= deadline) {
+                return false;
+            }
+            std::this_thread::yield();
+        }
+        return true;
+    }
+
+    void AtomicNotifyOne(std::atomic<uint32_t>& _word) noexcept {
+        _word.notify_one();
+    }
+
+    void AtomicNotifyAll(std::atomic<uint32_t>& _word) noexcept {
+        _word.notify_all();
+    }
+#endif
+}
@@ -1,7 +1,7 @@
 #include "CThreader/CThreader.hpp"
 
 namespace CT {
-    CThreader::CThreader() noexcept : m_taskIdCounter(0) {}
+    CThreader::CThreader() noexcept {}
 
 	CThreader::~CThreader() noexcept { Stop(CThreaderStopFlag::CLOSE_AFTER_COMPLETING_PROCESSED_TASKS); }
 
@@ -21,25 +21,166 @@ namespace CT {
 		m_threadPool.ClearTasks();
     }
 
-    std::expected<void, CThreaderError> CThreader::Initialize(std::optional<std::size_t> _threadCount) noexcept {
+    void CThreader::WaitIdle() noexcept {
+        m_threadPool.WaitIdle();
+    }
+
+    bool CThreader::WaitIdleFor(std::chrono::steady_clock::duration _timeout) noexcept {
+        return m_threadPool.WaitIdleFor(_timeout);
+    }
+
+    void CThreader::SetScheduling(const SchedulingOptions& _options) noexcept {
+        m_threadPool.SetScheduling(_options);
+    }
+
+    SchedulingOptions CThreader::GetScheduling() const noexcept {
+        return m_threadPool.GetScheduling();
+    }
+
+    SchedulingStats CThreader::GetSchedulingStats() const noexcept {
+        return m_threadPool.GetSchedulingStats();
+    }
+
+    PoolStats CThreader::GetStats() const {
+        return m_threadPool.GetStats();
+    }
+
+    PerfStats CThreader::GetPerfStats() const {
+        return m_threadPool.GetPerfStats();
+    }
+
+    std::expected<void, CThreaderError> CThreader::Initialize(std::optional<std::size_t> _threadCount, TopologyMode _mode) noexcept {
         const std::size_t threadCount = _threadCount.value_or(std::thread::hardware_concurrency());
         
         if (threadCount == 0) {
             return std::unexpected(CThreaderError::CThreaderNotInitialized);
         }
 
-        m_threadPool.Initialize(threadCount);
+        m_threadPool.Initialize(threadCount, _mode);
         return {};
     }
 
+    std::expected<void, CThreaderError> CThreader::Initialize(const ElasticOptions& _elastic, TopologyMode _mode) noexcept {
+        ElasticOptions elastic = _elastic;
+        if (elastic.maxThreads == 0) {
+            elastic.maxThreads = std::thread::hardware_concurrency();
+        }
+
+        if (elastic.maxThreads == 0) {
+            return std::unexpected(CThreaderError::CThreaderNotInitialized);
+        }
+
+        m_threadPool.Initialize(elastic.minThreads, _mode, elastic);
+        return {};
+    }
+
+    std::size_t CThreader::ActiveThreadCount() const noexcept {
+        return m_threadPool.ActiveThreadCount();
+    }
+
     uint64_t CThreader::Enqueue(Task&& _task, TaskLevel _taskLevel) noexcept {
-        const uint64_t taskId = m_taskIdCounter.fetch_add(1, std::memory_order_relaxed) + 1;
+        const uint64_t taskId = m_threadPool.ReserveResult();
+        _task.SetTaskId(taskId);
+        m_threadPool.PushTask(std::move(_task), _taskLevel);
+        return taskId;
+    }
+
+    void CThreader::Post(Task&& _task, TaskLevel _taskLevel) noexcept {
+        _task.SetTaskId(Task::kNoResultId);
+        m_threadPool.PushTask(std::move(_task), _taskLevel);
+    }
+
+    Detail::ScheduleAwaiter CThreader::Schedule(TaskLevel _taskLevel) noexcept {
+        return Detail::ScheduleAwaiter(m_threadPool, _taskLevel);
+    }
+
+    uint64_t CThreader::Enqueue(Task&& _task, std::chrono::steady_clock::time_point _deadline, TaskLevel _taskLevel) noexcept {
+        const uint64_t taskId = m_threadPool.ReserveResult();
+        _task.SetTaskId(taskId);
+        m_threadPool.PushDeadlineTask(std::move(_task), _taskLevel, _deadline);
+        return taskId;
+    }
+
+    void CThreader::Post(Task&& _task, std::chrono::steady_clock::time_point _deadline, TaskLevel _taskLevel) noexcept {
+        _task.SetTaskId(Task::kNoResultId);
+        m_threadPool.PushDeadlineTask(std::move(_task), _taskLevel, _deadline);
+    }
+
+    uint64_t CThreader::EnqueueOn(std::size_t _node, Task&& _task, TaskLevel _taskLevel) noexcept {
+        const uint64_t taskId = m_threadPool.ReserveResult();
+        _task.SetTaskId(taskId);
+        m_threadPool.PushTask(std::move(_task), _taskLevel, _node);
+        return taskId;
+    }
+
+    void CThreader::PostOn(std::size_t _node, Task&& _task, TaskLevel _taskLevel) noexcept {
+        _task.SetTaskId(Task::kNoResultId);
+        m_threadPool.PushTask(std::move(_task), _taskLevel, _node);
+    }
+
+    uint64_t CThreader::Enqueue(Task&& _task, const CancelGroup& _group, TaskLevel _taskLevel) noexcept {
+        const uint64_t taskId = m_threadPool.ReserveResult(_group);
         _task.SetTaskId(taskId);
         m_threadPool.PushTask(std::move(_task), _taskLevel);
         return taskId;
     }
 
+    bool CThreader::Cancel(uint64_t _taskId) noexcept {
+        return m_threadPool.CancelTask(_taskId);
+    }
+
+    void CThreader::Cancel(const CancelGroup& _group) noexcept {
+        _group.Cancel();
+    }
+
+    TimerId CThreader::EnqueueAfter(std::chrono::steady_clock::duration _delay, Task&& _task, TaskLevel _taskLevel) noexcept {
+        return EnqueueAt(std::chrono::steady_clock::now() + _delay, std::move(_task), _taskLevel);
+    }
+
+    TimerId CThreader::EnqueueAt(std::chrono::steady_clock::time_point _time, Task&& _task, TaskLevel _taskLevel) noexcept {
+        _task.SetTaskId(Task::kNoResultId);
+        return m_threadPool.AddTimer(std::move(_task), _taskLevel, _time);
+    }
+
+    TimerId CThreader::EnqueuePeriodic(std::chrono::steady_clock::duration _interval, Task&& _task, TaskLevel _taskLevel) noexcept {
+        _task.SetTaskId(Task::kNoResultId);
+        return m_threadPool.AddTimer(std::move(_task), _taskLevel, std::chrono::steady_clock::now() + _interval, _interval);
+    }
+
+    bool CThreader::CancelTimer(TimerId _id) noexcept {
+        return m_threadPool.CancelTimer(_id);
+    }
+
+    std::size_t CThreader::NodeCount() const noexcept {
+        return m_threadPool.NodeCount();
+    }
+
+    std::vector<uint64_t> CThreader::EnqueueBatch(std::span<Task> _tasks, TaskLevel _taskLevel) {
+        std::vector<uint64_t> ids(_tasks.size());
+        m_threadPool.ReserveResults(ids);
+        for (size_t i = 0; i < _tasks.size(); ++i) {
+            _tasks[i].SetTaskId(ids[i]);
+        }
+        m_threadPool.PushTasks(_tasks, _taskLevel);
+        return ids;
+    }
+
+    void CThreader::PostBatch(std::span<Task> _tasks, TaskLevel _taskLevel) noexcept {
+        for (Task& task : _tasks) {
+            task.SetTaskId(Task::kNoResultId);
+        }
+        m_threadPool.PushTasks(_tasks, _taskLevel);
+    }
+
+    std::expected<TaskHandle<void>, CThreaderError> CThreader::Run(TaskGraph& _graph) {
+        return _graph.Run(m_threadPool);
+    }
+
     std::expected<TaskResult, CThreaderError> CThreader::GetResult(const uint64_t& _taskId) noexcept {
         return m_threadPool.GetResult(_taskId);
     }
+
+    std::expected<TaskResult, CThreaderError> CThreader::TakeResult(const uint64_t& _taskId) noexcept {
+        return m_threadPool.TakeResult(_taskId);
+    }
 }
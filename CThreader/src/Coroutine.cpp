@@ -0,0 +1,63 @@
+#include "CThreader/Coroutine.hpp"
+#include <array>
+#include <new>
+#include <utility>
+
+namespace CT {
+    namespace {
+        constexpr size_t kFrameGranule = 64;
+        constexpr size_t kFrameClasses = 16;
+        constexpr size_t kFrameCacheSize = 256;
+
+        // Freed frames of this thread, one intrusive list per size class. A
+        // frame freed on another thread than it was made on joins that
+        // thread's lists, like task nodes do.
+        struct FrameCache {
+            struct Free {
+                Free* next;
+            };
+
+            ~FrameCache() {
+                for (Free*& head : heads) {
+                    while (head) {
+                        ::operator delete(std::exchange(head, head->next));
+                    }
+                }
+                counts.fill(0);
+            }
+
+            std::array<Free*, kFrameClasses> heads{};
+            std::array<size_t, kFrameClasses> counts{};
+        };
+        thread_local FrameCache t_frames;
+
+        constexpr size_t ClassOf(size_t _size) noexcept {
+            return _size == 0 ? 0 : (_size - 1) / kFrameGranule;
+        }
+    }
+
+    namespace Detail {
+        void* AllocateFrame(size_t _size) {
+            const size_t sizeClass = ClassOf(_size);
+            if (sizeClass >= kFrameClasses) {
+                return ::operator new(_size);
+            }
+            if (FrameCache::Free* frame = t_frames.heads[sizeClass]) {
+                t_frames.heads[sizeClass] = frame->next;
+                --t_frames.counts[sizeClass];
+                return frame;
+            }
+            return ::operator new((sizeClass + 1) * kFrameGranule);
+        }
+
+        void FreeFrame(void* _frame, size_t _size) noexcept {
+            const size_t sizeClass = ClassOf(_size);
+            if (sizeClass >= kFrameClasses || t_frames.counts[sizeClass] >= kFrameCacheSize) {
+                ::operator delete(_frame);
+                return;
+            }
+            t_frames.heads[sizeClass] = ::new (_frame) FrameCache::Free{ t_frames.heads[sizeClass] };
+            ++t_frames.counts[sizeClass];
+        }
+    }
+}
@@ -0,0 +1,120 @@
+#include "CThreader/Metrics.hpp"
+#include <algorithm>
+
+namespace CT {
+    namespace {
+        std::atomic<uint64_t> s_spins{ 0 };
+        std::atomic<uint64_t> s_yields{ 0 };
+    }
+
+    uint64_t LatencyHistogram::Count() const noexcept {
+        uint64_t total = 0;
+        for (const uint64_t c : counts) {
+            total += c;
+        }
+        return total;
+    }
+
+    uint64_t LatencyHistogram::Percentile(double _q) const noexcept {
+        const uint64_t total = Count();
+        if (total == 0) {
+            return 0;
+        }
+
+        const double q = std::clamp(_q, 0.0, 1.0);
+        const uint64_t rank = std::max<uint64_t>(static_cast<uint64_t>(q * static_cast<double>(total) + 0.5), 1);
+        uint64_t seen = 0;
+        for (size_t bucket = 0; bucket < kBuckets; ++bucket) {
+            seen += counts[bucket];
+            if (seen >= rank) {
+                return bucket == 0 ? 0 : uint64_t(1) << bucket;
+            }
+        }
+        return uint64_t(1) << (kBuckets - 1);
+    }
+
+    LatencyHistogram& LatencyHistogram::operator+=(const LatencyHistogram& _other) noexcept {
+        for (size_t bucket = 0; bucket < kBuckets; ++bucket) {
+            counts[bucket] += _other.counts[bucket];
+        }
+        return *this;
+    }
+
+    WorkerMetrics& WorkerMetrics::operator+=(const WorkerMetrics& _other) noexcept {
+        for (size_t band = 0; band < executed.size(); ++band) {
+            executed[band] += _other.executed[band];
+        }
+        deadlineExecuted += _other.deadlineExecuted;
+        queueWait += _other.queueWait;
+        execution += _other.execution;
+        idle += _other.idle;
+        parks += _other.parks;
+        steals += _other.steals;
+        stealMisses += _other.stealMisses;
+        localDepthHighWater = std::max(localDepthHighWater, _other.localDepthHighWater);
+        globalDepthHighWater = std::max(globalDepthHighWater, _other.globalDepthHighWater);
+        return *this;
+    }
+
+    namespace Detail {
+        void RecordSpin(uint64_t _spins, uint64_t _yields) noexcept {
+            s_spins.fetch_add(_spins, std::memory_order_relaxed);
+            if (_yields != 0) {
+                s_yields.fetch_add(_yields, std::memory_order_relaxed);
+            }
+        }
+
+        void ReadSpins(uint64_t& _spins, uint64_t& _yields) noexcept {
+            _spins = s_spins.load(std::memory_order_relaxed);
+            _yields = s_yields.load(std::memory_order_relaxed);
+        }
+
+#if CTHREADER_ENABLE_METRICS
+        void MetricsBlock::Bump(std::atomic<uint64_t>& _counter, uint64_t _n) noexcept {
+            if (m_shared) {
+                _counter.fetch_add(_n, std::memory_order_relaxed);
+            }
+            else {
+                _counter.store(_counter.load(std::memory_order_relaxed) + _n, std::memory_order_relaxed);
+            }
+        }
+
+        void MetricsBlock::Raise(std::atomic<size_t>& _high, size_t _value) noexcept {
+            size_t current = _high.load(std::memory_order_relaxed);
+            while (_value > current && !_high.compare_exchange_weak(current, _value, std::memory_order_relaxed)) {
+            }
+        }
+
+        void MetricsBlock::Executed(size_t _band, int64_t _queuedAt, int64_t _start, int64_t _end) noexcept {
+            using Ticks = std::chrono::steady_clock::duration;
+            const auto ns = [](int64_t _ticks) {
+                const auto d = std::chrono::duration_cast<std::chrono::nanoseconds>(Ticks(std::max<int64_t>(_ticks, 0)));
+                return static_cast<uint64_t>(d.count());
+            };
+
+            Bump(m_executed[std::min<size_t>(_band, kPriorityBands)]);
+            if (_queuedAt != 0) {
+                Bump(m_wait[LatencyHistogram::BucketOf(ns(_start - _queuedAt))]);
+            }
+            Bump(m_run[LatencyHistogram::BucketOf(ns(_end - _start))]);
+        }
+
+        void MetricsBlock::Snapshot(WorkerMetrics& _out) const noexcept {
+            for (size_t band = 0; band < kPriorityBands; ++band) {
+                _out.executed[band] += m_executed[band].load(std::memory_order_relaxed);
+            }
+            _out.deadlineExecuted += m_executed[kPriorityBands].load(std::memory_order_relaxed);
+            for (size_t bucket = 0; bucket < LatencyHistogram::kBuckets; ++bucket) {
+                _out.queueWait.counts[bucket] += m_wait[bucket].load(std::memory_order_relaxed);
+                _out.execution.counts[bucket] += m_run[bucket].load(std::memory_order_relaxed);
+            }
+            _out.idle += m_idle.load(std::memory_order_relaxed);
+            _out.parks += m_parks.load(std::memory_order_relaxed);
+            _out.steals += m_steals.load(std::memory_order_relaxed);
+            _out.stealMisses += m_stealMisses.load(std::memory_order_relaxed);
+            _out.localDepthHighWater = std::max(_out.localDepthHighWater, m_localHigh.load(std::memory_order_relaxed));
+            _out.globalDepthHighWater = std::max(_out.globalDepthHighWater, m_globalHigh.load(std::memory_order_relaxed));
+        }
+#endif
+    }
+}
@@ -0,0 +1,133 @@
+#include "CThreader/PerfCounters.hpp"
+#include <algorithm>
+
+#if CTHREADER_ENABLE_PERF_COUNTERS && defined(__linux__)
+#include <cstring>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace CT {
+    PerfCounters& PerfCounters::operator+=(const PerfCounters& _other) noexcept {
+        tasks += _other.tasks;
+        cycles += _other.cycles;
+        instructions += _other.instructions;
+        cacheMisses += _other.cacheMisses;
+        branchMisses += _other.branchMisses;
+        return *this;
+    }
+
+#if CTHREADER_ENABLE_PERF_COUNTERS
+    namespace {
+#if defined(__linux__)
+        // One event group per thread, cycles leading so the four are always
+        // scheduled onto the PMU together and one read() returns them all.
+        class ThreadCounters {
+        public:
+            ThreadCounters() noexcept {
+                constexpr uint64_t kEvents[4] = {
+                    PERF_COUNT_HW_CPU_CYCLES,
+                    PERF_COUNT_HW_INSTRUCTIONS,
+                    PERF_COUNT_HW_CACHE_MISSES,
+                    PERF_COUNT_HW_BRANCH_MISSES,
+                };
+                for (size_t i = 0; i < 4; ++i) {
+                    perf_event_attr attr;
+                    std::memset(&attr, 0, sizeof(attr));
+                    attr.size = sizeof(attr);
+                    attr.type = PERF_TYPE_HARDWARE;
+                    attr.config = kEvents[i];
+                    attr.read_format = PERF_FORMAT_GROUP;
+                    attr.exclude_kernel = 1;
+                    attr.exclude_hv = 1;
+                    attr.disabled = i == 0 ? 1 : 0;
+                    const long fd = syscall(SYS_perf_event_open, &attr, 0, -1, i == 0 ? -1 : m_fds[0], 0);
+                    if (fd < 0) {
+                        Close();
+                        return;
+                    }
+                    m_fds[i] = static_cast<int>(fd);
+                }
+                ioctl(m_fds[0], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+            }
+
+            ~ThreadCounters() { Close(); }
+
+            ThreadCounters(const ThreadCounters&) = delete;
+            ThreadCounters& operator=(const ThreadCounters&) = delete;
+
+            bool Read(Detail::PerfSample& _out) const noexcept {
+                if (m_fds[0] < 0) {
+                    return false;
+                }
+                // PERF_FORMAT_GROUP: the event count, then one value each.
+                uint64_t buffer[5];
+                if (read(m_fds[0], buffer, sizeof(buffer)) != static_cast<ssize_t>(sizeof(buffer)) || buffer[0] != 4) {
+                    return false;
+                }
+                std::copy(buffer + 1, buffer + 5, _out.values.begin());
+                return true;
+            }
+
+        private:
+            void Close() noexcept {
+                for (int& fd : m_fds) {
+                    if (fd >= 0) {
+                        close(fd);
+                        fd = -1;
+                    }
+                }
+            }
+
+            int m_fds[4]{ -1, -1, -1, -1 };
+        };
+#else
+        class ThreadCounters {
+        public:
+            bool Read(Detail::PerfSample&) const noexcept { return false; }
+        };
+#endif
+    }
+
+    namespace Detail {
+        bool PerfRead(PerfSample& _out) noexcept {
+            thread_local const ThreadCounters counters;
+            return counters.Read(_out);
+        }
+
+        void PerfBlock::Bump(std::atomic<uint64_t>& _counter, uint64_t _n) noexcept {
+            if (m_shared) {
+                _counter.fetch_add(_n, std::memory_order_relaxed);
+            }
+            else {
+                _counter.store(_counter.load(std::memory_order_relaxed) + _n, std::memory_order_relaxed);
+            }
+        }
+
+        void PerfBlock::Record(uint32_t _tag, const PerfSample& _before, const PerfSample& _after) noexcept {
+            Slot& slot = m_slots[std::min<size_t>(_tag, kPerfTags - 1)];
+            Bump(slot.tasks, 1);
+            for (size_t i = 0; i < slot.values.size(); ++i) {
+                Bump(slot.values[i], _after.values[i] - _before.values[i]);
+            }
+        }
+
+        void PerfBlock::Snapshot(std::array<PerfCounters, kPerfTags>& _tags, PerfCounters& _total, bool& _available) const noexcept {
+            for (size_t tag = 0; tag < kPerfTags; ++tag) {
+                const Slot& slot = m_slots[tag];
+                PerfCounters counts;
+                counts.tasks = slot.tasks.load(std::memory_order_relaxed);
+                counts.cycles = slot.values[0].load(std::memory_order_relaxed);
+                counts.instructions = slot.values[1].load(std::memory_order_relaxed);
+                counts.cacheMisses = slot.values[2].load(std::memory_order_relaxed);
+                counts.branchMisses = slot.values[3].load(std::memory_order_relaxed);
+                _available = _available || counts.tasks != 0;
+                _tags[tag] += counts;
+                _total += counts;
+            }
+        }
+    }
+#endif
+}
@@ -0,0 +1,279 @@
+#include "CThreader/ResultStore.hpp"
+#include "CThreader/CpuRelax.hpp"
+#include <bit>
+#include <new>
+
+namespace CT {
+    ResultStore::~ResultStore() {
+        for (auto& chunk : m_chunks) {
+            delete[] chunk.load(std::memory_order_relaxed);
+        }
+    }
+
+    ResultStore::Slot* ResultStore::Locate(uint32_t _index) noexcept {
+        const uint64_t n = _index / kBaseChunk + 1;
+        const size_t k = static_cast<size_t>(std::bit_width(n) - 1);
+        const size_t offset = _index - kBaseChunk * ((size_t(1) << k) - 1);
+
+        Slot* chunk = m_chunks[k].load(std::memory_order_acquire);
+        if (!chunk) {
+            Slot* fresh = new (std::nothrow) Slot[kBaseChunk << k];
+            if (!fresh) {
+                return nullptr;
+            }
+            if (m_chunks[k].compare_exchange_strong(chunk, fresh, std::memory_order_acq_rel, std::memory_order_acquire)) {
+                chunk = fresh;
+            }
+            else {
+                delete[] fresh;
+            }
+        }
+        return chunk + offset;
+    }
+
+    ResultStore::Slot* ResultStore::Find(uint64_t _id) noexcept {
+        const uint32_t index = IndexOf(_id);
+        if (GenerationOf(_id) == 0 || index >= m_nextIndex.load(std::memory_order_acquire)) {
+            return nullptr;
+        }
+        return Locate(index);
+    }
+
+    uint64_t ResultStore::Acquire() {
+        uint32_t index = 0;
+        Slot* slot = nullptr;
+
+        uint64_t head = m_freeHead.load(std::memory_order_acquire);
+        while (static_cast<uint32_t>(head) != 0) {
+            index = static_cast<uint32_t>(head) - 1;
+            slot = Locate(index);
+            const uint64_t next = ((head >> 32) + 1) << 32 | slot->next.load(std::memory_order_relaxed);
+            if (m_freeHead.compare_exchange_weak(head, next, std::memory_order_acq_rel, std::memory_order_acquire)) {
+                break;
+            }
+            slot = nullptr;
+        }
+
+        if (!slot) {
+            index = static_cast<uint32_t>(m_nextIndex.fetch_add(1, std::memory_order_acq_rel));
+            slot = Locate(index);
+            if (!slot) {
+                throw std::bad_alloc();
+            }
+        }
+
+        return Claim(index, *slot);
+    }
+
+    uint64_t ResultStore::Claim(uint32_t _index, Slot& _slot) noexcept {
+        const uint32_t generation = GenerationOf(_slot.word.load(std::memory_order_relaxed));
+        _slot.group.reset();
+        _slot.word.store(Word(generation, Pending), std::memory_order_release);
+        return (uint64_t(generation) << 32) | _index;
+    }
+
+    void ResultStore::AcquireBatch(std::span<uint64_t> _ids) {
+        size_t filled = 0;
+
+        // Detach the whole free list, keep what we need and hand the rest back.
+        uint64_t head = m_freeHead.load(std::memory_order_acquire);
+        while (static_cast<uint32_t>(head) != 0
+            && !m_freeHead.compare_exchange_weak(head, ((head >> 32) + 1) << 32, std::memory_order_acq_rel, std::memory_order_acquire)) {
+        }
+
+        uint32_t link = static_cast<uint32_t>(head);
+        while (link != 0 && filled < _ids.size()) {
+            const uint32_t index = link - 1;
+            Slot* slot = Locate(index);
+            link = slot->next.load(std::memory_order_relaxed);
+            _ids[filled++] = Claim(index, *slot);
+        }
+
+        if (link != 0) {
+            uint64_t empty = m_freeHead.load(std::memory_order_acquire);
+            for (;;) {
+                if (static_cast<uint32_t>(empty) == 0) {
+                    if (m_freeHead.compare_exchange_weak(empty, ((empty >> 32) + 1) << 32 | link, std::memory_order_acq_rel, std::memory_order_acquire)) {
+                        break;
+                    }
+                    continue;
+                }
+
+                // Someone pushed meanwhile: append their list behind our remainder.
+                Slot* tail = Locate(link - 1);
+                for (uint32_t next = tail->next.load(std::memory_order_relaxed); next != 0; next = tail->next.load(std::memory_order_relaxed)) {
+                    tail = Locate(next - 1);
+                }
+                tail->next.store(static_cast<uint32_t>(empty), std::memory_order_relaxed);
+                if (m_freeHead.compare_exchange_weak(empty, ((empty >> 32) + 1) << 32 | link, std::memory_order_acq_rel, std::memory_order_acquire)) {
+                    break;
+                }
+                tail->next.store(0, std::memory_order_relaxed);
+            }
+        }
+
+        const size_t missing = _ids.size() - filled;
+        if (missing == 0) {
+            return;
+        }
+
+        const uint32_t first = static_cast<uint32_t>(m_nextIndex.fetch_add(missing, std::memory_order_acq_rel));
+        for (size_t i = 0; i < missing; ++i) {
+            Slot* slot = Locate(first + static_cast<uint32_t>(i));
+            if (!slot) {
+                throw std::bad_alloc();
+            }
+            _ids[filled++] = Claim(first + static_cast<uint32_t>(i), *slot);
+        }
+    }
+
+    bool ResultStore::Settle(Slot& _slot, uint32_t _generation, SlotState _state) noexcept {
+        uint64_t expected = Word(_generation, Pending);
+        return _slot.word.compare_exchange_strong(expected, Word(_generation, _state), std::memory_order_acq_rel, std::memory_order_relaxed);
+    }
+
+    void ResultStore::Join(uint64_t _id, const CancelGroup& _group) noexcept {
+        if (Slot* slot = Find(_id)) {
+            slot->group = _group.m_state;
+        }
+    }
+
+    void ResultStore::Publish(uint64_t _id, TaskResult&& _result) noexcept {
+        Slot* slot = Find(_id);
+        const uint32_t generation = GenerationOf(_id);
+        if (!slot || !Settle(*slot, generation, Busy)) {
+            return; // cancelled meanwhile; nobody wants the value
+        }
+
+        if (slot->group && slot->group->load(std::memory_order_acquire)) {
+            slot->word.store(Word(generation, Cancelled), std::memory_order_release);
+            return;
+        }
+        slot->value = std::move(_result);
+        slot->word.store(Word(generation, Ready), std::memory_order_release);
+    }
+
+    void ResultStore::Fail(uint64_t _id, CThreaderError _error) noexcept {
+        if (Slot* slot = Find(_id)) {
+            const SlotState state = _error == CThreaderError::DeadlineMissed ? Missed
+                : _error == CThreaderError::TaskCancelled ? Cancelled : Failed;
+            Settle(*slot, GenerationOf(_id), state);
+        }
+    }
+
+    bool ResultStore::Cancel(uint64_t _id) noexcept {
+        Slot* slot = Find(_id);
+        return slot && Settle(*slot, GenerationOf(_id), Cancelled);
+    }
+
+    CancelToken ResultStore::Token(uint64_t _id) noexcept {
+        CancelToken token;
+        Slot* slot = Find(_id);
+        if (!slot) {
+            return token;
+        }
+        token.m_word = &slot->word;
+        token.m_pending = Word(GenerationOf(_id), Pending);
+        if (slot->word.load(std::memory_order_acquire) == token.m_pending) {
+            token.m_group = slot->group;
+        }
+        return token;
+    }
+
+    void ResultStore::Release(uint64_t _id) noexcept {
+        Slot* slot = Find(_id);
+        if (!slot) {
+            return;
+        }
+
+        const uint32_t generation = GenerationOf(_id);
+        uint64_t expected = slot->word.load(std::memory_order_acquire);
+        for (;;) {
+            if (GenerationOf(expected) != generation || (expected & 0xFFFFFFFFu) == Free) {
+                return;
+            }
+            if ((expected & 0xFFFFFFFFu) == Busy) {
+                CpuRelax();
+                expected = slot->word.load(std::memory_order_acquire);
+                continue;
+            }
+            if (slot->word.compare_exchange_weak(expected, Word(generation, Busy), std::memory_order_acquire)) {
+                break;
+            }
+        }
+
+        slot->value = TaskResult{};
+        Recycle(IndexOf(_id), *slot, generation);
+    }
+
+    void ResultStore::Recycle(uint32_t _index, Slot& _slot, uint32_t _generation) noexcept {
+        uint32_t next = _generation + 1;
+        if (next == 0) {
+            next = 1; // generation 0 is never handed out
+        }
+        _slot.word.store(Word(next, Free), std::memory_order_release);
+
+        uint64_t head = m_freeHead.load(std::memory_order_acquire);
+        for (;;) {
+            _slot.next.store(static_cast<uint32_t>(head), std::memory_order_relaxed);
+            const uint64_t fresh = ((head >> 32) + 1) << 32 | (uint64_t(_index) + 1);
+            if (m_freeHead.compare_exchange_weak(head, fresh, std::memory_order_acq_rel, std::memory_order_acquire)) {
+                return;
+            }
+        }
+    }
+
+    std::expected<TaskResult, CThreaderError> ResultStore::Read(uint64_t _id, bool _take) noexcept {
+        Slot* slot = Find(_id);
+        if (!slot) {
+            return std::unexpected(CThreaderError::TaskNotFound);
+        }
+
+        const uint32_t generation = GenerationOf(_id);
+        uint64_t expected = slot->word.load(std::memory_order_acquire);
+        for (;;) {
+            if (GenerationOf(expected) != generation) {
+                return std::unexpected(CThreaderError::TaskNotFound);
+            }
+
+            const uint32_t state = static_cast<uint32_t>(expected);
+            if (state == Busy) {
+                CpuRelax();
+                expected = slot->word.load(std::memory_order_acquire);
+                continue;
+            }
+            if (state == Failed || state == Missed || state == Cancelled) {
+                if (_take && slot->word.compare_exchange_strong(expected, Word(generation, Busy), std::memory_order_acquire)) {
+                    Recycle(IndexOf(_id), *slot, generation);
+                }
+                return std::unexpected(state == Missed ? CThreaderError::DeadlineMissed
+                    : state == Cancelled ? CThreaderError::TaskCancelled : CThreaderError::TaskFailed);
+            }
+            if (state != Ready) {
+                return std::unexpected(CThreaderError::TaskNotFound);
+            }
+            if (slot->word.compare_exchange_weak(expected, Word(generation, Busy), std::memory_order_acquire)) {
+                break;
+            }
+        }
+
+        if (!_take) {
+            TaskResult copy = slot->value;
+            slot->word.store(Word(generation, Ready), std::memory_order_release);
+            return copy;
+        }
+
+        TaskResult out = std::move(slot->value);
+        slot->value = TaskResult{};
+        Recycle(IndexOf(_id), *slot, generation);
+        return out;
+    }
+
+    std::expected<TaskResult, CThreaderError> ResultStore::Get(uint64_t _id) noexcept {
+        return Read(_id, false);
+    }
+
+    std::expected<TaskResult, CThreaderError> ResultStore::Take(uint64_t _id) noexcept {
+        return Read(_id, true);
+    }
+}
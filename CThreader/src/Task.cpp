@@ -1,11 +1,59 @@
 #include "CThreader/Task.hpp"
 
 namespace CT {
-	std::any Task::Execute() const {
-		if (m_task)
-			return m_task();
+	Task::~Task() {
+		Reset();
+	}
+
+	Task::Task(Task&& _other) noexcept
+		: m_ops(_other.m_ops), m_taskId(_other.m_taskId) {
+#if CTHREADER_ENABLE_METRICS
+		m_queuedAt = _other.m_queuedAt;
+#endif
+#if CTHREADER_ENABLE_TRACING
+		m_traceId = _other.m_traceId;
+#endif
+#if CTHREADER_ENABLE_PERF_COUNTERS
+		m_tag = _other.m_tag;
+#endif
+		if (m_ops) {
+			m_ops->move(m_storage, _other.m_storage);
+			_other.m_ops = nullptr;
+		}
+	}
+
+	Task& Task::operator=(Task&& _other) noexcept {
+		if (this != &_other) {
+			Reset();
+			m_ops = _other.m_ops;
+			m_taskId = _other.m_taskId;
+#if CTHREADER_ENABLE_METRICS
+			m_queuedAt = _other.m_queuedAt;
+#endif
+#if CTHREADER_ENABLE_TRACING
+			m_traceId = _other.m_traceId;
+#endif
+#if CTHREADER_ENABLE_PERF_COUNTERS
+			m_tag = _other.m_tag;
+#endif
+			if (m_ops) {
+				m_ops->move(m_storage, _other.m_storage);
+				_other.m_ops = nullptr;
+			}
+		}
+		return *this;
+	}
 
-		return std::any{};
+	void Task::Reset() noexcept {
+		if (m_ops) {
+			m_ops->destroy(m_storage);
+			m_ops = nullptr;
+		}
+	}
+
+	void Task::Execute(TaskResult* _result, const CancelToken& _token) {
+		if (m_ops)
+			m_ops->invoke(m_storage, _result, _token);
 	}
 
 	void Task::SetTaskId(uint64_t _taskId) noexcept {
@@ -15,4 +63,8 @@ namespace CT {
 	std::uint64_t Task::GetTaskId() const noexcept {
 		return m_taskId;
 	}
-} 
+
+	Task::operator bool() const noexcept {
+		return m_ops != nullptr;
+	}
+}
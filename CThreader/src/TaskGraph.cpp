@@ -0,0 +1,185 @@
+#include "CThreader/TaskGraph.hpp"
+#include "CThreader/ThreadPool.hpp"
+#include <stdexcept>
+#include <utility>
+
+namespace CT {
+    TaskGraph::NodeId TaskGraph::Add(Task&& _task, TaskLevel _taskLevel) {
+        auto node = std::make_unique<Node>();
+        node->task = std::move(_task);
+        node->task.SetTaskId(Task::kNoResultId);
+        node->level = _taskLevel;
+        m_nodes.emplace_back(std::move(node));
+        m_validated = false;
+        return static_cast<NodeId>(m_nodes.size() - 1);
+    }
+
+    std::expected<void, CThreaderError> TaskGraph::Precede(NodeId _before, NodeId _after) {
+        if (_before >= m_nodes.size() || _after >= m_nodes.size()) {
+            return std::unexpected(CThreaderError::TaskNotFound);
+        }
+        if (_before == _after) {
+            return std::unexpected(CThreaderError::GraphHasCycle);
+        }
+
+        m_nodes[_before]->successors.push_back(_after);
+        ++m_nodes[_after]->predecessors;
+        m_validated = false;
+        return {};
+    }
+
+    bool TaskGraph::Validate() {
+        // Kahn's algorithm: every node must be reachable by peeling off roots.
+        std::vector<uint32_t> indegree(m_nodes.size());
+        m_roots.clear();
+        for (size_t i = 0; i < m_nodes.size(); ++i) {
+            indegree[i] = m_nodes[i]->predecessors;
+            if (indegree[i] == 0) {
+                m_roots.push_back(static_cast<NodeId>(i));
+            }
+        }
+
+        std::vector<NodeId> ready = m_roots;
+        size_t visited = 0;
+        while (!ready.empty()) {
+            const NodeId id = ready.back();
+            ready.pop_back();
+            ++visited;
+            for (NodeId next : m_nodes[id]->successors) {
+                if (--indegree[next] == 0) {
+                    ready.push_back(next);
+                }
+            }
+        }
+
+        m_validated = visited == m_nodes.size();
+        return m_validated;
+    }
+
+    std::expected<TaskHandle<void>, CThreaderError> TaskGraph::Run(ThreadPool& _pool) {
+        if (m_running.exchange(true, std::memory_order_acq_rel)) {
+            return std::unexpected(CThreaderError::GraphAlreadyRunning);
+        }
+        if (!m_validated && !Validate()) {
+            m_running.store(false, std::memory_order_release);
+            return std::unexpected(CThreaderError::GraphHasCycle);
+        }
+
+        auto state = std::make_shared<TaskState<void>>();
+        TaskHandle<void> handle(state);
+        if (m_nodes.empty()) {
+            m_running.store(false, std::memory_order_release);
+            state->SetValue();
+            return handle;
+        }
+
+        for (auto& node : m_nodes) {
+            node->pending.store(node->predecessors, std::memory_order_relaxed);
+        }
+        m_pool = &_pool;
+        m_state = std::move(state);
+        m_error = nullptr;
+        m_failed.store(false, std::memory_order_relaxed);
+        m_remaining.store(m_nodes.size(), std::memory_order_release);
+
+        for (NodeId id : m_roots) {
+            Schedule(id);
+        }
+        return handle;
+    }
+
+    class TaskGraph::NodeRun {
+    public:
+        NodeRun(TaskGraph& _graph, NodeId _id) noexcept : m_graph(&_graph), m_id(_id) {}
+        NodeRun(NodeRun&& _other) noexcept : m_graph(std::exchange(_other.m_graph, nullptr)), m_id(_other.m_id) {}
+        NodeRun& operator=(NodeRun&&) = delete;
+
+        ~NodeRun() {
+            if (m_graph) {
+                m_graph->Drop(m_id);
+            }
+        }
+
+        void operator()() noexcept { std::exchange(m_graph, nullptr)->Execute(m_id); }
+
+    private:
+        TaskGraph* m_graph;
+        NodeId m_id;
+    };
+
+    void TaskGraph::Schedule(NodeId _id) noexcept {
+        Task task{ NodeRun(*this, _id) };
+        m_pool->PushTask(std::move(task), m_nodes[_id]->level);
+    }
+
+    void TaskGraph::Execute(NodeId _id) noexcept {
+        Node& node = *m_nodes[_id];
+        if (!m_failed.load(std::memory_order_relaxed)) {
+            try {
+                node.task.Execute();
+            }
+            catch (...) {
+                if (!m_failed.exchange(true, std::memory_order_relaxed)) {
+                    m_error = std::current_exception();
+                }
+            }
+        }
+
+        Release(_id);
+    }
+
+    // Successors a dropped node was the last predecessor of are retired
+    // here rather than queued: the pool that dropped it may be going away,
+    // and they would be skipped anyway. A work list keeps long chains off
+    // the stack.
+    void TaskGraph::Drop(NodeId _id) noexcept {
+        if (!m_failed.exchange(true, std::memory_order_relaxed)) {
+            m_error = std::make_exception_ptr(std::runtime_error("Task was dropped before it completed."));
+        }
+
+        std::vector<NodeId> retired{ _id };
+        while (!retired.empty()) {
+            const NodeId id = retired.back();
+            retired.pop_back();
+            for (NodeId next : m_nodes[id]->successors) {
+                if (m_nodes[next]->pending.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+                    retired.push_back(next);
+                }
+            }
+
+            if (m_remaining.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+                Finish();
+            }
+        }
+    }
+
+    // Counts _id as done and queues the successors it was the last
+    // predecessor of.
+    void TaskGraph::Release(NodeId _id) noexcept {
+        for (NodeId next : m_nodes[_id]->successors) {
+            if (m_nodes[next]->pending.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+                Schedule(next);
+            }
+        }
+
+        if (m_remaining.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            Finish();
+        }
+    }
+
+    void TaskGraph::Finish() noexcept {
+        // Clear the run before completing it so a waiter can start the next
+        // run as soon as the handle turns ready.
+        std::shared_ptr<TaskState<void>> state = std::move(m_state);
+        std::exception_ptr error = std::move(m_error);
+        m_error = nullptr;
+        m_running.store(false, std::memory_order_release);
+
+        if (error) {
+            state->SetException(std::move(error));
+        }
+        else {
+            state->SetValue();
+        }
+    }
+}
@@ -5,14 +5,18 @@ namespace CT {
 		: m_value(std::move(_value)) { }
 
 	bool TaskResult::HasValue() const noexcept {
-		return m_value.has_value();
+		return m_inlineType || m_value.has_value();
 	}
 
 	void TaskResult::SetValue(std::any&& _value) noexcept {
 		m_value = std::move(_value);
+		m_inlineType = nullptr;
 	}
 
 	std::any TaskResult::GetValue() const {
+		if (m_inlineType)
+			return m_box(m_inline);
+
 		if (m_value)
 			return m_value.value();
 
@@ -21,10 +25,18 @@ namespace CT {
 
 	const std::any& TaskResult::GetValueRef() const noexcept {
 		static const std::any empty;
+		if (m_inlineType && !m_value) {
+			try {
+				m_value = m_box(m_inline);
+			}
+			catch (...) {
+				return empty;
+			}
+		}
 		return m_value ? *m_value : empty;
 	}
 
 	TaskResult::operator bool() const noexcept {
 		return HasValue();
 	}
-}
\ No newline at end of file
+}
@@ -1,41 +1,170 @@
 #include "CThreader/ThreadPool.hpp"
 #include <algorithm>
+#include <condition_variable>
+#include <utility>
+#include <bit>
+#include <cstdio>
 
 namespace CT {
+    namespace {
+        struct WorkerContext {
+            const ThreadPool* pool{ nullptr };
+            size_t index{ 0 };
+        };
+        thread_local WorkerContext t_worker;
+        thread_local size_t t_wakeCursor = 0;
+        // BlockingRegion nesting depth on a worker thread.
+        thread_local uint32_t t_blockingDepth = 0;
+        // Counter deltas of the tasks run nested in the current one, through
+        // RunPendingTask; taken out of its own delta so none is counted twice.
+        thread_local Detail::PerfSample t_perfNested;
 
-    ThreadPool::ThreadPool() noexcept {}
+        // Deadline queue shard for pushes from non-worker threads.
+        std::atomic<size_t> s_nextShard{ 0 };
+        thread_local size_t t_shard = s_nextShard.fetch_add(1, std::memory_order_relaxed);
 
-    void ThreadPool::Stop(const CThreaderStopFlag _flag) noexcept {
-        switch (_flag) {
-        case CThreaderStopFlag::CLOSE_AFTER_COMPLETING_PROCESSED_TASKS:
-        {
-            m_cv.notify_all();
+        // Idle rounds before parking; each round looks for work once and then
+        // pauses for kRelaxPerSpin CpuRelax() calls (a few microseconds total).
+        constexpr uint32_t kIdleSpins = 64;
+        constexpr uint32_t kRelaxPerSpin = 4;
+
+        // Recycles the nodes that carry nested enqueues through the worker
+        // deques, so steady-state fork-join work does not hit the allocator.
+        constexpr size_t kNodeCacheSize = 256;
+        struct NodeCache {
+            ~NodeCache() {
+                for (Task* node : nodes) {
+                    delete node;
+                }
+            }
+            std::vector<Task*> nodes;
+        };
+        thread_local NodeCache t_nodes;
+
+        Task* AcquireNode(Task&& _task) {
+            auto& nodes = t_nodes.nodes;
+            if (nodes.empty()) {
+                return new Task(std::move(_task));
+            }
+            Task* node = nodes.back();
+            nodes.pop_back();
+            *node = std::move(_task);
+            return node;
+        }
+
+        void ReleaseNode(Task* _node) noexcept {
+            auto& nodes = t_nodes.nodes;
+            if (nodes.capacity() == 0) {
+                nodes.reserve(kNodeCacheSize);
+            }
+            if (nodes.size() < kNodeCacheSize) {
+                nodes.push_back(_node);
+            }
+            else {
+                delete _node;
+            }
+        }
+
+        constexpr size_t BandOf(TaskLevel _taskLevel) noexcept {
+            const auto band = static_cast<uint64_t>(_taskLevel);
+            return band < kPriorityBands ? static_cast<size_t>(band) : kPriorityBands - 1;
+        }
+
+        constexpr uint64_t BandBit(size_t _band) noexcept {
+            return uint64_t(1) << _band;
+        }
+
+        constexpr size_t HighestBand(uint64_t _bits) noexcept {
+            return 63 - static_cast<size_t>(std::countl_zero(_bits));
+        }
+    }
+
+    ThreadPool::Worker::~Worker() {
+        Task* node = nullptr;
+        for (auto& deque : local) {
+            while (deque.steal(node)) {
+                delete node;
+            }
+        }
+    }
 
+    ThreadPool::ThreadPool() noexcept {
+        SetScheduling(SchedulingOptions{});
+        BuildQueues(1);
+    }
+
+    void ThreadPool::BuildQueues(size_t _nodeCount) {
+        if (m_queues.size() == _nodeCount) {
+            return;
+        }
+
+        std::vector<std::unique_ptr<QueueSet>> queues;
+        for (size_t i = 0; i < _nodeCount; ++i) {
+            auto& set = queues.emplace_back(std::make_unique<QueueSet>());
+            set->bands[BandOf(TaskLevel::High)].reserve(256);
+            set->bands[BandOf(TaskLevel::Medium)].reserve(512);
+            set->bands[BandOf(TaskLevel::Low)].reserve(1024);
+        }
+
+        // Carry over anything queued under the old layout.
+        Task tmp;
+        for (auto& set : m_queues) {
+            for (size_t band = 0; band < kBandCount; ++band) {
+                while (set->bands[band].try_pop(tmp)) {
+                    queues[0]->bands[band].push(std::move(tmp));
+                    queues[0]->occupied.fetch_or(BandBit(band), std::memory_order_relaxed);
+                }
+            }
+        }
+
+        m_queues = std::move(queues);
+        m_nodeWorkers.assign(_nodeCount, {});
+    }
+
+    void ThreadPool::Stop(const CThreaderStopFlag _flag) noexcept {
+        // AddWorker checks m_stopped under the same lock, so no worker can
+        // start after this and miss the stop request.
+        const auto stopThreads = [this] {
+            m_monitor.request_stop();
+            {
+                // Pending timers stay in the wheel for the next Start.
+                std::lock_guard timerLock(m_timerMutex);
+                m_timersEnabled = false;
+            }
+            m_timerThread.request_stop();
+            std::lock_guard lock(m_threadsMutex);
+            m_stopped = true;
             for (auto& t : m_threads) {
                 t.request_stop();
             }
+        };
+
+        switch (_flag) {
+        case CThreaderStopFlag::CLOSE_AFTER_COMPLETING_PROCESSED_TASKS:
+        {
+            stopThreads();
+            WakeAll();
 
             break;
         }
         case CThreaderStopFlag::CLOSE_AFTER_COMPLETING_THE_TASKS:
         default:
         {
-            std::unique_lock<std::mutex> lk(m_sleepMx);
-            m_cv.notify_all();
-            lk.unlock();
-
-            auto queues_empty = [this]() noexcept {
-                return m_qHigh.empty() && m_qMedium.empty() && m_qLow.empty();
-            };
+            WakeAll();
 
-            while (!queues_empty()) {
-                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            // Queued and running tasks both count; nobody is left to run
+            // them once the pool is stopped.
+            bool running = false;
+            {
+                std::lock_guard lock(m_threadsMutex);
+                running = !m_threads.empty() && !m_stopped;
             }
-
-            for (auto& t : m_threads) {
-                t.request_stop();
+            if (running) {
+                WaitIdle();
             }
-            m_cv.notify_all();
+
+            stopThreads();
+            WakeAll();
 
             break;
         }
@@ -46,132 +175,1171 @@ namespace CT {
         if (!m_threads.empty())
             return;
 
-        m_threads.reserve(m_threadCount);
+        const size_t slotCount = m_elastic.maxThreads + m_elastic.maxCompensation;
+        if (m_workers.size() != slotCount || m_layoutChanged) {
+            // Hand anything left in a previous worker set back to the global queues.
+            Task* node = nullptr;
+            for (auto& w : m_workers) {
+                for (size_t band = 0; band < kBandCount; ++band) {
+                    while (w->local[band].steal(node)) {
+                        PushGlobal(std::min(w->node, m_queues.size() - 1), band, node, 1);
+                        delete node;
+                    }
+                }
+            }
+
+            // NumaAware: deal CPUs out one node at a time so workers spread
+            // over every node's cores and memory bandwidth.
+            std::vector<std::pair<size_t, uint32_t>> slots;
+            if (m_mode == TopologyMode::NumaAware) {
+                const auto& nodes = m_topology.Nodes();
+                for (size_t k = 0; slots.size() < m_topology.CpuCount(); ++k) {
+                    for (size_t n = 0; n < nodes.size(); ++n) {
+                        if (k < nodes[n].cpus.size()) {
+                            slots.emplace_back(n, nodes[n].cpus[k]);
+                        }
+                    }
+                }
+            }
+
+            m_workers.clear();
+            m_workers.reserve(slotCount);
+            m_nodeWorkers.assign(m_queues.size(), {});
+            for (size_t i = 0; i < slotCount; ++i) {
+                auto& w = m_workers.emplace_back(std::make_unique<Worker>());
+                w->rng = 0x9E3779B97F4A7C15ull * (i + 1);
+                if (!slots.empty()) {
+                    const auto& [nodeIndex, cpu] = slots[i % slots.size()];
+                    w->node = nodeIndex;
+                    w->cpu = cpu;
+                }
+                m_nodeWorkers[w->node].push_back(i);
+            }
+            m_layoutChanged = false;
+        }
+
+        m_threads.resize(slotCount);
+        m_stopped = false;
+        m_active.store(m_threadCount, std::memory_order_relaxed);
+        m_blocked.store(0, std::memory_order_relaxed);
+        m_stalled.store(0, std::memory_order_relaxed);
+        m_compensating.store(0, std::memory_order_relaxed);
         for (size_t i = 0; i < m_threadCount; ++i) {
-            m_threads.emplace_back([this](std::stop_token st) {
-                WorkerLoop(st);
+            LaunchWorker(i);
+        }
+
+        if (m_elastic.minThreads < m_elastic.maxThreads || m_elastic.stallAfter.count() > 0) {
+            m_monitor = std::jthread([this](std::stop_token st) {
+                MonitorLoop(st);
+            });
+        }
+
+        std::lock_guard timerLock(m_timerMutex);
+        m_timersEnabled = true;
+        if (m_timers.Size() != 0) {
+            m_timerThread = std::jthread([this](std::stop_token st) {
+                TimerLoop(st);
             });
         }
     }
 
+    void ThreadPool::LaunchWorker(size_t _index) {
+        m_workers[_index]->active.store(true, std::memory_order_relaxed);
+        m_threads[_index] = std::jthread([this, _index](std::stop_token st) {
+            WorkerLoop(st, _index);
+        });
+    }
+
     void ThreadPool::Kill(const CThreaderStopFlag _flag) noexcept {
         Stop(_flag);
 
+        // Joined before the workers so it is not reading them meanwhile.
+        m_monitor = std::jthread();
+        m_timerThread = std::jthread();
+
         std::vector<std::jthread> to_join;
         to_join.swap(m_threads);
     }
 
     void ThreadPool::ClearTasks() noexcept {
+        {
+            std::lock_guard lock(m_timerMutex);
+            m_timers.Clear();
+        }
+
+        // Dropped tasks give their result slots back.
         Task tmp;
-        while (m_qHigh.try_pop(tmp)) { }
-        while (m_qMedium.try_pop(tmp)) { }
-        while (m_qLow.try_pop(tmp)) { }
+        int64_t deadline = 0;
+        size_t dropped = 0;
+        while (m_deadlines.try_pop(0, tmp, deadline)) { m_results.Release(tmp.GetTaskId()); ++dropped; }
+
+        for (auto& set : m_queues) {
+            for (auto& queue : set->bands) {
+                while (queue.try_pop(tmp)) { m_results.Release(tmp.GetTaskId()); ++dropped; }
+            }
+        }
+
+        Task* node = nullptr;
+        for (auto& w : m_workers) {
+            for (auto& deque : w->local) {
+                while (deque.steal(node)) {
+                    m_results.Release(node->GetTaskId());
+                    delete node;
+                    ++dropped;
+                }
+            }
+        }
+
+        if (dropped != 0) {
+            TaskDone(dropped);
+        }
     }
 
-    void ThreadPool::Initialize(size_t _threadCount) noexcept {
+    void ThreadPool::Initialize(size_t _threadCount, TopologyMode _mode, const ElasticOptions& _elastic) noexcept {
         m_threadCount = std::max<size_t>(_threadCount, 1);
-        
-        m_qHigh.reserve(256);
-        m_qMedium.reserve(512);
-        m_qLow.reserve(1024);
+        m_elastic = _elastic;
+        if (m_elastic.maxThreads == 0) {
+            m_elastic.minThreads = m_elastic.maxThreads = m_threadCount;
+        }
+        else {
+            m_elastic.minThreads = std::clamp<size_t>(m_elastic.minThreads, 1, m_elastic.maxThreads);
+            m_threadCount = std::clamp(m_threadCount, m_elastic.minThreads, m_elastic.maxThreads);
+        }
+        m_mode = _mode;
+        m_topology = _mode == TopologyMode::NumaAware ? Topology::Discover() : Topology{};
+        if (m_topology.Nodes().empty()) {
+            // Nothing known about the machine: NumaAware degrades to Flat.
+            m_mode = TopologyMode::Flat;
+        }
+        m_layoutChanged = true;
+
+        BuildQueues(m_mode == TopologyMode::NumaAware ? m_topology.NodeCount() : 1);
+    }
+
+    uint64_t ThreadPool::ReserveResult() {
+        return m_results.Acquire();
+    }
+
+    uint64_t ThreadPool::ReserveResult(const CancelGroup& _group) {
+        const uint64_t id = m_results.Acquire();
+        m_results.Join(id, _group);
+        return id;
+    }
+
+    void ThreadPool::ReserveResults(std::span<uint64_t> _ids) {
+        m_results.AcquireBatch(_ids);
+    }
+
+    bool ThreadPool::CancelTask(uint64_t _taskId) noexcept {
+        return m_results.Cancel(_taskId);
+    }
+
+    MPMCQueue<Task>& ThreadPool::GlobalQueue(size_t _node, size_t _band) noexcept {
+        return m_queues[_node]->bands[_band];
+    }
+
+    void ThreadPool::PushGlobal(size_t _node, size_t _band, Task* _tasks, size_t _count) {
+        QueueSet& set = *m_queues[_node];
+        if (_count == 1) {
+            set.bands[_band].push(std::move(*_tasks));
+        }
+        else {
+            set.bands[_band].push_bulk(_tasks, _count);
+        }
 
-        m_results.resize(1024);
-        m_resultsSize.store(1024, std::memory_order_relaxed);
+        if constexpr (kMetricsEnabled) {
+            Detail::MetricsBlock& metrics = t_worker.pool == this ? m_workers[t_worker.index]->metrics : m_externalMetrics;
+            metrics.GlobalDepth(set.bands[_band].size());
+        }
+
+        // Pairs with the fence in PopGlobal: either this load sees the bit
+        // cleared and sets it again, or that consumer's re-check sees the push.
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if ((set.occupied.load(std::memory_order_relaxed) & BandBit(_band)) == 0) {
+            set.occupied.fetch_or(BandBit(_band), std::memory_order_relaxed);
+        }
+    }
+
+    bool ThreadPool::PopGlobal(size_t _node, size_t _band, Task& _out) noexcept {
+        QueueSet& set = *m_queues[_node];
+        if ((set.occupied.load(std::memory_order_relaxed) & BandBit(_band)) == 0) {
+            return false;
+        }
+        if (set.bands[_band].try_pop(_out)) {
+            return true;
+        }
+
+        set.occupied.fetch_and(~BandBit(_band), std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (set.bands[_band].empty()) {
+            return false;
+        }
+        set.occupied.fetch_or(BandBit(_band), std::memory_order_relaxed);
+        return set.bands[_band].try_pop(_out);
+    }
+
+    void ThreadPool::PushLocal(Worker& _self, size_t _band, Task&& _task) {
+        _self.local[_band].push(AcquireNode(std::move(_task)));
+        if constexpr (kMetricsEnabled) {
+            _self.metrics.LocalDepth(_self.local[_band].size());
+        }
+        const uint64_t bits = _self.localBits.load(std::memory_order_relaxed);
+        if ((bits & BandBit(_band)) == 0) {
+            _self.localBits.store(bits | BandBit(_band), std::memory_order_release);
+        }
     }
 
-    void ThreadPool::EnsureResultCapacity(uint64_t id) {
-        uint64_t cur = m_resultsSize.load(std::memory_order_acquire);
-        if (id < cur) {
+    void ThreadPool::MarkStealable(size_t _band) noexcept {
+        // Callers have passed a seq_cst fence since PushLocal (WakeWorkers),
+        // which pairs with the one in DropStealHint.
+        if ((m_stealBits.load(std::memory_order_relaxed) & BandBit(_band)) == 0) {
+            m_stealBits.fetch_or(BandBit(_band), std::memory_order_relaxed);
+        }
+    }
+
+    void ThreadPool::DropStealHint(size_t _band) noexcept {
+        m_stealBits.fetch_and(~BandBit(_band), std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        // A push may have found the hint still set just before it went.
+        for (const auto& w : m_workers) {
+            if ((w->localBits.load(std::memory_order_relaxed) & BandBit(_band)) != 0 && !w->local[_band].empty()) {
+                m_stealBits.fetch_or(BandBit(_band), std::memory_order_relaxed);
+                return;
+            }
+        }
+    }
+
+    uint64_t ThreadPool::SharedBits() const noexcept {
+        uint64_t bits = m_stealBits.load(std::memory_order_relaxed);
+        for (const auto& set : m_queues) {
+            bits |= set->occupied.load(std::memory_order_relaxed);
+        }
+        return bits;
+    }
+
+    size_t ThreadPool::LocalNode() const noexcept {
+        if (t_worker.pool == this) {
+            return m_workers[t_worker.index]->node;
+        }
+        if (m_mode == TopologyMode::NumaAware) {
+            if (const auto cpu = Topology::CurrentCpu()) {
+                return std::min(m_topology.NodeOfCpu(*cpu), m_queues.size() - 1);
+            }
+        }
+        return 0;
+    }
+
+    bool ThreadPool::HasQueuedTasks() const noexcept {
+        if (!m_deadlines.empty()) {
+            return true;
+        }
+
+        // Only bands flagged in a bitmap are looked at; a stale bit costs one
+        // empty() call.
+        for (const auto& set : m_queues) {
+            for (uint64_t bits = set->occupied.load(std::memory_order_relaxed); bits != 0; bits &= bits - 1) {
+                if (!set->bands[std::countr_zero(bits)].empty()) {
+                    return true;
+                }
+            }
+        }
+
+        for (const auto& w : m_workers) {
+            for (uint64_t bits = w->localBits.load(std::memory_order_relaxed); bits != 0; bits &= bits - 1) {
+                if (!w->local[std::countr_zero(bits)].empty()) {
+                    return true;
+                }
+            }
+        }
+        return false;
+    }
+
+    size_t ThreadPool::QueuedTaskCount() const noexcept {
+        size_t count = m_deadlines.size();
+        for (const auto& set : m_queues) {
+            for (uint64_t bits = set->occupied.load(std::memory_order_relaxed); bits != 0; bits &= bits - 1) {
+                count += set->bands[std::countr_zero(bits)].size();
+            }
+        }
+
+        for (const auto& w : m_workers) {
+            for (uint64_t bits = w->localBits.load(std::memory_order_relaxed); bits != 0; bits &= bits - 1) {
+                count += w->local[std::countr_zero(bits)].size();
+            }
+        }
+        return count;
+    }
+
+    void ThreadPool::PushTask(Task&& _task, TaskLevel _taskLevel, size_t _node) noexcept {
+        m_outstanding.fetch_add(1, std::memory_order_relaxed);
+        if constexpr (kMetricsEnabled) {
+            _task.SetQueuedAt(Detail::MetricsNow());
+        }
+        const size_t band = BandOf(_taskLevel);
+        Detail::TraceEnqueue(_task, static_cast<uint32_t>(band));
+        const size_t node = _node == kAnyNode ? LocalNode() : _node % m_queues.size();
+        if (t_worker.pool == this && m_workers[t_worker.index]->node == node) {
+            // Nested enqueue: keep it on this worker, idle workers can steal it.
+            PushLocal(*m_workers[t_worker.index], band, std::move(_task));
+            WakeWorkers(1);
+            MarkStealable(band);
             return;
         }
 
-        const auto s = ShardOf(id);
-        std::scoped_lock grow(m_resultsGrowMx);
+        PushGlobal(node, band, &_task, 1);
+        WakeWorkers(1);
+    }
 
-        std::lock_guard<SpinLock> g(m_resultShards[s].lock);
-        cur = m_resultsSize.load(std::memory_order_relaxed);
-        if (id < cur) {
+    void ThreadPool::PushTasks(std::span<Task> _tasks, TaskLevel _taskLevel, size_t _node) noexcept {
+        if (_tasks.empty()) {
             return;
         }
 
-        size_t newCap = std::max<size_t>(cur * 2, static_cast<size_t>(id + 1));
-        m_results.resize(newCap);
-        m_resultsSize.store(newCap, std::memory_order_release);
+        m_outstanding.fetch_add(_tasks.size(), std::memory_order_relaxed);
+        if constexpr (kMetricsEnabled) {
+            const int64_t now = Detail::MetricsNow();
+            for (Task& task : _tasks) {
+                task.SetQueuedAt(now);
+            }
+        }
+        const size_t band = BandOf(_taskLevel);
+        if constexpr (kTracingEnabled) {
+            for (Task& task : _tasks) {
+                Detail::TraceEnqueue(task, static_cast<uint32_t>(band));
+            }
+        }
+        const size_t node = _node == kAnyNode ? LocalNode() : _node % m_queues.size();
+        if (t_worker.pool == this && m_workers[t_worker.index]->node == node) {
+            Worker& self = *m_workers[t_worker.index];
+            for (Task& task : _tasks) {
+                PushLocal(self, band, std::move(task));
+            }
+            WakeWorkers(_tasks.size());
+            MarkStealable(band);
+            return;
+        }
+
+        PushGlobal(node, band, _tasks.data(), _tasks.size());
+        WakeWorkers(_tasks.size());
     }
 
-    void ThreadPool::PushTask(Task&& _task, TaskLevel _taskLevel) noexcept {
-        const uint64_t id = _task.GetTaskId();
-        EnsureResultCapacity(id);
+    void ThreadPool::PushDeadlineTask(Task&& _task, TaskLevel _taskLevel, std::chrono::steady_clock::time_point _deadline) noexcept {
+        if (m_policy.load(std::memory_order_relaxed) != SchedulingPolicy::EarliestDeadline) {
+            PushTask(std::move(_task), _taskLevel);
+            return;
+        }
 
-        switch (_taskLevel) {
-        case TaskLevel::High: {
-            m_qHigh.push(std::move(_task));
-            break;
+        m_outstanding.fetch_add(1, std::memory_order_relaxed);
+        if constexpr (kMetricsEnabled) {
+            _task.SetQueuedAt(Detail::MetricsNow());
         }
-        case TaskLevel::Medium: {
-            m_qMedium.push(std::move(_task));
-            break;
+        Detail::TraceEnqueue(_task, static_cast<uint32_t>(kBandCount));
+        const size_t shard = t_worker.pool == this ? t_worker.index : t_shard;
+        m_deadlines.push(shard, _deadline.time_since_epoch().count(), std::move(_task));
+        WakeWorkers(1);
+    }
+
+    void ThreadPool::WakeWorkers(size_t _count) noexcept {
+        // Pairs with the fence in Park: either this load sees the sleeper or
+        // the sleeper's re-check sees the task just published.
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (m_sleepers.load(std::memory_order_relaxed) == 0) {
+            return;
         }
-        default:                 {
-            m_qLow.push(std::move(_task));
-            break;
+
+        const size_t n = m_workers.size();
+        const size_t start = t_wakeCursor++;
+        for (size_t i = 0; i < n && _count > 0; ++i) {
+            Worker& w = *m_workers[(start + i) % n];
+            uint32_t expected = 1;
+            if (w.parked.load(std::memory_order_relaxed) == 1
+                && w.parked.compare_exchange_strong(expected, 0, std::memory_order_acq_rel)) {
+                m_sleepers.fetch_sub(1, std::memory_order_relaxed);
+                AtomicNotifyOne(w.parked);
+                --_count;
+            }
+        }
+    }
+
+    void ThreadPool::WakeAll() noexcept {
+        WakeWorkers(m_workers.size());
+    }
+
+    bool ThreadPool::TakeShared(uint64_t& _rng, const Worker* _self, size_t _home, size_t _band, Task& _out) noexcept {
+        // Own node first; other nodes' queues and workers only when it is dry.
+        const bool stealable = (m_stealBits.load(std::memory_order_relaxed) & BandBit(_band)) != 0;
+        const size_t nodes = m_queues.size();
+        for (size_t i = 0; i < nodes; ++i) {
+            const size_t node = (_home + i) % nodes;
+            if (PopGlobal(node, _band, _out) || (stealable && TrySteal(_rng, _self, m_nodeWorkers[node], _band, _out))) {
+                return true;
+            }
+        }
+
+        if (stealable) {
+            DropStealHint(_band);
+        }
+        return false;
+    }
+
+    bool ThreadPool::TrySteal(uint64_t& _rng, const Worker* _self, const std::vector<size_t>& _victims, size_t _band, Task& _out) noexcept {
+        const size_t n = _victims.size();
+        if (n == 0 || (n == 1 && m_workers[_victims[0]].get() == _self)) {
+            return false;
         }
+
+        uint64_t& x = _rng; // xorshift64
+        x ^= x << 13;
+        x ^= x >> 7;
+        x ^= x << 17;
+
+        const size_t start = static_cast<size_t>(x % n);
+        Task* node = nullptr;
+        for (size_t i = 0; i < n; ++i) {
+            Worker& victim = *m_workers[_victims[(start + i) % n]];
+            if (&victim != _self
+                && (victim.localBits.load(std::memory_order_relaxed) & BandBit(_band)) != 0
+                && victim.local[_band].steal(node)) {
+                _out = std::move(*node);
+                ReleaseNode(node);
+                if constexpr (kMetricsEnabled) {
+                    if (_self) {
+                        m_workers[t_worker.index]->metrics.Stole();
+                    }
+                }
+                return true;
+            }
         }
 
-        m_cv.notify_one();
+        if constexpr (kMetricsEnabled) {
+            if (_self) {
+                m_workers[t_worker.index]->metrics.StealMissed();
+            }
+        }
+        return false;
+    }
+
+    bool ThreadPool::TakeBand(Worker& _self, size_t _band, Task& _out) noexcept {
+        const uint64_t own = _self.localBits.load(std::memory_order_relaxed);
+        if ((own & BandBit(_band)) != 0) {
+            Task* node = nullptr;
+            if (_self.local[_band].pop(node)) {
+                _out = std::move(*node);
+                ReleaseNode(node);
+                return true;
+            }
+            _self.localBits.store(own & ~BandBit(_band), std::memory_order_relaxed);
+        }
+        return TakeShared(_self.rng, &_self, _self.node, _band, _out);
     }
 
-    void ThreadPool::WorkerLoop(std::stop_token st) {
+    bool ThreadPool::TakeMasked(Worker& _self, uint64_t _mask, Task& _out) noexcept {
+        // Highest band that may hold work anywhere, found with one
+        // countl_zero; a band that turns out empty is masked off.
+        uint64_t bits = (_self.localBits.load(std::memory_order_relaxed) | SharedBits()) & _mask;
+        while (bits != 0) {
+            const size_t band = HighestBand(bits);
+            if (TakeBand(_self, band, _out)) {
+                _self.band = band;
+                auto& served = _self.served[TierOf(band)];
+                served.store(served.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+                return true;
+            }
+            bits &= ~BandBit(band);
+        }
+        return false;
+    }
+
+    bool ThreadPool::FindTask(Worker& _self, Task& _out) noexcept {
+        // Checked under every policy so deadline tasks queued before a
+        // switch away from EarliestDeadline still drain.
+        if (!m_deadlines.empty() && TakeDeadline(_self, _out)) {
+            return true;
+        }
+
+        switch (m_policy.load(std::memory_order_relaxed)) {
+        case SchedulingPolicy::WeightedFair: return FindWeighted(_self, _out);
+        case SchedulingPolicy::AgePromotion: return FindAged(_self, _out);
+        case SchedulingPolicy::StrictPriority:
+        case SchedulingPolicy::EarliestDeadline:
+        default:                             return FindStrict(_self, _out);
+        }
+    }
+
+    bool ThreadPool::TakeDeadline(Worker& _self, Task& _out) noexcept {
+        int64_t deadline = 0;
+        while (m_deadlines.try_pop(t_worker.index, _out, deadline)) {
+            if (m_dropMissed.load(std::memory_order_relaxed)
+                && std::chrono::steady_clock::now().time_since_epoch().count() > deadline) {
+                if (const uint64_t id = _out.GetTaskId(); id != Task::kNoResultId) {
+                    m_results.Fail(id, CThreaderError::DeadlineMissed);
+                }
+                _out = Task{};
+                TaskDone(1);
+                _self.deadlineDropped.store(_self.deadlineDropped.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+                _self.deadlineMissed.store(_self.deadlineMissed.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+                continue;
+            }
+            _self.deadline = deadline;
+            _self.band = kBandCount;
+            return true;
+        }
+        return false;
+    }
+
+    void ThreadPool::RunFound(Worker& _self, Task& _task) noexcept {
+        const int64_t deadline = std::exchange(_self.deadline, 0);
+        Detail::Trace(Detail::TraceEvent::Dequeue, _task.GetTraceId(), _task.GetTaskId(), static_cast<uint32_t>(_self.band));
+        if constexpr (kMetricsEnabled) {
+            const int64_t queuedAt = _task.GetQueuedAt();
+            const int64_t start = Detail::MetricsNow();
+            RunTask(_task);
+            _self.metrics.Executed(_self.band, queuedAt, start, Detail::MetricsNow());
+        }
+        else {
+            RunTask(_task);
+        }
+        if (deadline != 0) {
+            auto& counter = std::chrono::steady_clock::now().time_since_epoch().count() > deadline
+                ? _self.deadlineMissed : _self.deadlineMet;
+            counter.store(counter.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        }
+    }
+
+    bool ThreadPool::TakeTier(Worker& _self, size_t _tier, Task& _out) noexcept {
+        return TakeMasked(_self, TierMask(_tier), _out);
+    }
+
+    bool ThreadPool::FindStrict(Worker& _self, Task& _out) noexcept {
+        // A lower band is only looked at once this worker's deque, the global
+        // queues and every victim are empty in the bands above it.
+        return TakeMasked(_self, ~uint64_t(0), _out);
+    }
+
+    bool ThreadPool::FindWeighted(Worker& _self, Task& _out) noexcept {
+        // Deficit round-robin with unit cost per task. Tiers are still tried
+        // High first, so High latency only grows once it has spent its credit;
+        // the round restarts when no tier with credit left has work.
+        for (int pass = 0; pass < 2; ++pass) {
+            for (size_t tier = kTierCount; tier-- > 0; ) {
+                if (_self.credit[tier] != 0 && TakeTier(_self, tier, _out)) {
+                    --_self.credit[tier];
+                    return true;
+                }
+            }
+            for (size_t tier = 0; tier < kTierCount; ++tier) {
+                _self.credit[tier] = m_weights[tier].load(std::memory_order_relaxed);
+            }
+        }
+        return false;
+    }
+
+    bool ThreadPool::FindAged(Worker& _self, Task& _out) noexcept {
+        const int64_t now = std::chrono::steady_clock::now().time_since_epoch().count();
+        const int64_t maxAge = m_maxAge.load(std::memory_order_relaxed);
+
+        // Lowest tier first: the one starved the longest gets promoted.
+        for (size_t tier = 0; tier + 1 < kTierCount; ++tier) {
+            if (now - m_lastServed[tier].load(std::memory_order_relaxed) > maxAge && TakeTier(_self, tier, _out)) {
+                m_lastServed[tier].store(now, std::memory_order_relaxed);
+                return true;
+            }
+        }
+
+        for (size_t tier = kTierCount; tier-- > 0; ) {
+            if (TakeTier(_self, tier, _out)) {
+                // Throttled so busy tiers do not bounce this line between cores.
+                if (now - m_lastServed[tier].load(std::memory_order_relaxed) > maxAge / 8) {
+                    m_lastServed[tier].store(now, std::memory_order_relaxed);
+                }
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void ThreadPool::SetScheduling(const SchedulingOptions& _options) noexcept {
+        for (size_t tier = 0; tier < kTierCount; ++tier) {
+            m_weights[tier].store(std::max<uint32_t>(_options.weights[tier], 1), std::memory_order_relaxed);
+        }
+        const auto maxAge = std::chrono::duration_cast<std::chrono::steady_clock::duration>(_options.maxAge);
+        m_maxAge.store(static_cast<int64_t>(maxAge.count()), std::memory_order_relaxed);
+        m_dropMissed.store(_options.dropMissed, std::memory_order_relaxed);
+        m_policy.store(_options.policy, std::memory_order_relaxed);
+    }
+
+    SchedulingOptions ThreadPool::GetScheduling() const noexcept {
+        SchedulingOptions options;
+        options.policy = m_policy.load(std::memory_order_relaxed);
+        for (size_t tier = 0; tier < kTierCount; ++tier) {
+            options.weights[tier] = m_weights[tier].load(std::memory_order_relaxed);
+        }
+        options.maxAge = std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::duration(m_maxAge.load(std::memory_order_relaxed)));
+        options.dropMissed = m_dropMissed.load(std::memory_order_relaxed);
+        return options;
+    }
+
+    SchedulingStats ThreadPool::GetSchedulingStats() const noexcept {
+        SchedulingStats stats;
+        for (size_t tier = 0; tier < kTierCount; ++tier) {
+            stats.executed[tier] = m_helperServed[tier].load(std::memory_order_relaxed);
+            for (const auto& w : m_workers) {
+                stats.executed[tier] += w->served[tier].load(std::memory_order_relaxed);
+            }
+        }
+
+        for (const auto& w : m_workers) {
+            stats.deadlineMet += w->deadlineMet.load(std::memory_order_relaxed);
+            stats.deadlineMissed += w->deadlineMissed.load(std::memory_order_relaxed);
+            stats.deadlineDropped += w->deadlineDropped.load(std::memory_order_relaxed);
+        }
+
+        const uint64_t total = stats.executed[0] + stats.executed[1] + stats.executed[2];
+        for (size_t tier = 0; tier < kTierCount && total != 0; ++tier) {
+            stats.share[tier] = static_cast<double>(stats.executed[tier]) / static_cast<double>(total);
+        }
+        return stats;
+    }
+
+    PoolStats ThreadPool::GetStats() const {
+        PoolStats stats;
+        stats.workers.resize(m_workers.size());
+        for (size_t i = 0; i < m_workers.size(); ++i) {
+            m_workers[i]->metrics.Snapshot(stats.workers[i]);
+            stats.total += stats.workers[i];
+        }
+        m_externalMetrics.Snapshot(stats.external);
+        stats.total += stats.external;
+        if constexpr (kMetricsEnabled) {
+            Detail::ReadSpins(stats.spinLockSpins, stats.spinLockYields);
+        }
+        return stats;
+    }
+
+    PerfStats ThreadPool::GetPerfStats() const {
+        PerfStats stats;
+        stats.workers.resize(m_workers.size());
+        for (size_t i = 0; i < m_workers.size(); ++i) {
+            m_workers[i]->perf.Snapshot(stats.tags, stats.workers[i], stats.available);
+        }
+        m_externalPerf.Snapshot(stats.tags, stats.external, stats.available);
+        return stats;
+    }
+
+    void ThreadPool::WorkerLoop(std::stop_token st, size_t _index) {
+        t_worker = { this, _index };
+        Detail::TraceSetWorker(static_cast<uint32_t>(_index));
+        Worker& self = *m_workers[_index];
+        if (self.cpu) {
+            Topology::PinCurrentThread(*self.cpu);
+        }
+
+        const bool watched = m_elastic.stallAfter.count() > 0;
         while (!st.stop_requested()) {
             Task t;
-            bool got = false;
-
-            if (!got) got = m_qHigh.try_pop(t);
-            if (!got) got = m_qMedium.try_pop(t);
-            if (!got) got = m_qLow.try_pop(t);
-
-            if (!got) {
-                std::unique_lock lk(m_sleepMx);
-                m_cv.wait(lk, [&] {
-                    return st.stop_requested()
-                        || !m_qHigh.empty()
-                        || !m_qMedium.empty()
-                        || !m_qLow.empty();
-                });
+            if (FindTask(self, t) || SpinForTask(self, t)) {
+                if (watched) {
+                    self.busySince.store(std::chrono::steady_clock::now().time_since_epoch().count(), std::memory_order_relaxed);
+                }
+                RunFound(self, t);
+                if (watched) {
+                    self.busySince.store(0, std::memory_order_relaxed);
+                }
+                if (HasSurplus() && RetireSurplus(self)) {
+                    return;
+                }
                 continue;
             }
+            if ((HasSurplus() && RetireSurplus(self)) || Park(self, st)) {
+                return;
+            }
+        }
+    }
 
-            try {
-                std::any r = t.Execute();
-
-                const uint64_t id = t.GetTaskId();
-                const size_t shard = ShardOf(id);
-                {
-                    std::lock_guard<SpinLock> g(m_resultShards[shard].lock);
-                    if (id >= m_resultsSize.load(std::memory_order_acquire)) {
-                        EnsureResultCapacity(id);
-                    }
-                    m_results[id].SetValue(std::move(r));
+    bool ThreadPool::SpinForTask(Worker& _self, Task& _out) noexcept {
+        _self.metrics.Idle();
+        for (uint32_t spin = 0; spin < kIdleSpins; ++spin) {
+            for (uint32_t i = 0; i < kRelaxPerSpin; ++i) {
+                CpuRelax();
+            }
+            if (FindTask(_self, _out)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    bool ThreadPool::Park(Worker& _self, const std::stop_token& _st) noexcept {
+        _self.parked.store(1, std::memory_order_relaxed);
+        m_sleepers.fetch_add(1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+
+        if (_st.stop_requested() || HasQueuedTasks()) {
+            // Work arrived (or Stop) between the last look and now. If a
+            // producer already claimed this worker it also fixed the count.
+            uint32_t expected = 1;
+            if (_self.parked.compare_exchange_strong(expected, 0, std::memory_order_acq_rel)) {
+                m_sleepers.fetch_sub(1, std::memory_order_relaxed);
+            }
+            return false;
+        }
+
+        // Workers beyond the minimum wait out the keep-alive and then retire;
+        // the rest sleep until woken.
+        const bool mayRetire = m_active.load(std::memory_order_relaxed) > m_elastic.minThreads;
+        _self.metrics.Parked();
+        while (_self.parked.load(std::memory_order_acquire) == 1) {
+            if (!mayRetire) {
+                AtomicWait(_self.parked, 1);
+            }
+            else if (!AtomicWaitFor(_self.parked, 1, m_elastic.keepAlive) && TryRetire(_self)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    bool ThreadPool::TryRetire(Worker& _self) noexcept {
+        size_t active = m_active.load(std::memory_order_relaxed);
+        do {
+            if (active <= m_elastic.minThreads) {
+                return false;
+            }
+        } while (!m_active.compare_exchange_weak(active, active - 1, std::memory_order_relaxed));
+
+        // Leave the sleeper set the same way a producer would take us out of
+        // it; if one got here first it is handing us a task.
+        uint32_t expected = 1;
+        if (!_self.parked.compare_exchange_strong(expected, 0, std::memory_order_acq_rel)) {
+            m_active.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        m_sleepers.fetch_sub(1, std::memory_order_relaxed);
+
+        // A producer that saw us parked a moment ago may have skipped its
+        // wakeup; stay if anything is queued. The local deques are empty here:
+        // only this worker pushes to them and it found nothing before parking.
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (HasQueuedTasks()) {
+            m_active.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+
+        // Last touch of the slot: from here the monitor may join and reuse it.
+        _self.active.store(false, std::memory_order_release);
+        return true;
+    }
+
+    void ThreadPool::MonitorLoop(std::stop_token _st) {
+        using namespace std::chrono;
+        // Backlog that persists with no parked worker means tasks are waiting
+        // on busy ones; the time it lasts stands in for queue wait time.
+        const bool watched = m_elastic.stallAfter.count() > 0;
+        auto period = std::clamp<microseconds>(m_elastic.growAfter / 4, microseconds(100), microseconds(1000));
+        if (watched) {
+            period = std::min<microseconds>(period, std::max<microseconds>(m_elastic.stallAfter / 4, microseconds(100)));
+        }
+        std::mutex mutex;
+        std::condition_variable_any tick;
+        std::unique_lock lock(mutex);
+        // Start of the current backlog; time_point{} while there is none.
+        steady_clock::time_point backlogSince{};
+
+        while (!tick.wait_for(lock, _st, period, [&_st] { return _st.stop_requested(); })) {
+            if (watched) {
+                m_stalled.store(CountStalled(), std::memory_order_relaxed);
+                if (HasSurplus()) {
+                    WakeWorkers(1); // a parked worker picks up the retirement
+                }
+                else if (m_sleepers.load(std::memory_order_relaxed) == 0 && HasQueuedTasks()) {
+                    Compensate();
                 }
             }
+
+            const size_t active = m_active.load(std::memory_order_relaxed);
+            const size_t depth = QueuedTaskCount();
+            if (active >= m_elastic.maxThreads || depth == 0 || m_sleepers.load(std::memory_order_relaxed) != 0) {
+                backlogSince = {};
+                continue;
+            }
+
+            const auto now = steady_clock::now();
+            if (backlogSince == steady_clock::time_point{}) {
+                backlogSince = now;
+            }
+            if (depth >= m_elastic.growDepth * active || now - backlogSince >= m_elastic.growAfter) {
+                AddWorker();
+                backlogSince = {};
+            }
+        }
+    }
+
+    bool ThreadPool::AddWorker() {
+        std::lock_guard lock(m_threadsMutex);
+        if (m_stopped) {
+            return false;
+        }
+
+        for (size_t i = 0; i < m_workers.size(); ++i) {
+            if (m_workers[i]->active.load(std::memory_order_acquire)) {
+                continue;
+            }
+            if (m_threads[i].joinable()) {
+                m_threads[i].join(); // retired; already past its last access
+            }
+
+            m_active.fetch_add(1, std::memory_order_relaxed);
+            try {
+                LaunchWorker(i);
+            }
             catch (...) {
-				std::print("Task ID {} execution threw an exception.\n", t.GetTaskId());
+                // Out of threads: stay at the current size.
+                m_workers[i]->active.store(false, std::memory_order_relaxed);
+                m_active.fetch_sub(1, std::memory_order_relaxed);
+                return false;
             }
+            return true;
         }
+        return false;
+    }
+
+    void ThreadPool::RunTask(Task& _task) noexcept {
+        const uint64_t id = _task.GetTaskId();
+        const uint64_t traceId = _task.GetTraceId();
+        Detail::Trace(Detail::TraceEvent::Start, traceId, id);
+        Detail::PerfSample before;
+        const bool counted = kPerfCountersEnabled && Detail::PerfRead(before);
+        Detail::PerfSample enclosing;
+        if constexpr (kPerfCountersEnabled) {
+            enclosing = std::exchange(t_perfNested, Detail::PerfSample{});
+        }
+        CancelToken token;
+        try {
+            if (id == Task::kNoResultId) {
+                _task.Execute(); // Post / TaskHandle: nothing to store
+            }
+            else if (token = m_results.Token(id); token.stop_requested()) {
+                // Cancelled while queued: the slot already says so, skip the run.
+                m_results.Cancel(id);
+            }
+            else {
+                TaskResult r;
+                _task.Execute(&r, token);
+                m_results.Publish(id, std::move(r));
+            }
+        }
+        catch (...) {
+            if (token.stop_requested()) {
+                m_results.Fail(id, CThreaderError::TaskCancelled);
+            }
+            else {
+                std::fprintf(stderr, "Task ID %llu execution threw an exception.\n", static_cast<unsigned long long>(id));
+                m_results.Fail(id);
+            }
+        }
+
+        if constexpr (kPerfCountersEnabled) {
+            const Detail::PerfSample nested = std::exchange(t_perfNested, enclosing);
+            if (Detail::PerfSample after; counted && Detail::PerfRead(after)) {
+                for (size_t i = 0; i < after.values.size(); ++i) {
+                    t_perfNested.values[i] += after.values[i] - before.values[i];
+                    after.values[i] -= nested.values[i];
+                }
+                Detail::PerfBlock& perf = t_worker.pool == this ? m_workers[t_worker.index]->perf : m_externalPerf;
+                perf.Record(_task.GetTag(), before, after);
+            }
+        }
+
+        // Captures go before the task counts as done, so WaitIdle callers
+        // may tear down whatever they referenced.
+        _task = Task{};
+        Detail::Trace(Detail::TraceEvent::Finish, traceId, id);
+        TaskDone(1);
+    }
+
+    void ThreadPool::TaskDone(size_t _count) noexcept {
+        // Pairs with WaitForIdle: either this load sees the waiter or the
+        // waiter's check of m_outstanding sees zero.
+        if (m_outstanding.fetch_sub(_count, std::memory_order_seq_cst) == _count
+            && m_idleWaiters.load(std::memory_order_seq_cst) != 0) {
+            m_idleEpoch.fetch_add(1, std::memory_order_release);
+            AtomicNotifyAll(m_idleEpoch);
+        }
+    }
+
+    bool ThreadPool::WaitForIdle(std::optional<std::chrono::steady_clock::time_point> _until) noexcept {
+        m_idleWaiters.fetch_add(1, std::memory_order_seq_cst);
+        bool idle = false;
+        for (;;) {
+            const uint32_t epoch = m_idleEpoch.load(std::memory_order_acquire);
+            if (m_outstanding.load(std::memory_order_seq_cst) == 0) {
+                idle = true;
+                break;
+            }
+
+            if (!_until) {
+                AtomicWait(m_idleEpoch, epoch);
+                continue;
+            }
+            const auto left = *_until - std::chrono::steady_clock::now();
+            if (left <= std::chrono::steady_clock::duration::zero()) {
+                break;
+            }
+            AtomicWaitFor(m_idleEpoch, epoch, left);
+        }
+        m_idleWaiters.fetch_sub(1, std::memory_order_relaxed);
+        return idle;
+    }
+
+    void ThreadPool::WaitIdle() noexcept {
+        WaitForIdle(std::nullopt);
+    }
+
+    bool ThreadPool::WaitIdleFor(std::chrono::steady_clock::duration _timeout) noexcept {
+        return WaitForIdle(std::chrono::steady_clock::now() + _timeout);
+    }
+
+    bool ThreadPool::ShouldSplit(TaskLevel _taskLevel) noexcept {
+        const size_t band = BandOf(_taskLevel);
+        if (t_worker.pool == this) {
+            return m_workers[t_worker.index]->local[band].empty();
+        }
+        return GlobalQueue(LocalNode(), band).empty();
+    }
+
+    bool ThreadPool::RunPendingTask() noexcept {
+        Task t;
+        if (t_worker.pool == this) {
+            Worker& self = *m_workers[t_worker.index];
+            if (!FindTask(self, t)) {
+                return false;
+            }
+            RunFound(self, t);
+            return true;
+        }
+
+        thread_local uint64_t rng = 0x9E3779B97F4A7C15ull ^ reinterpret_cast<uintptr_t>(&rng);
+        bool found = false;
+        size_t band = 0;
+        const size_t home = LocalNode();
+        for (uint64_t bits = SharedBits(); bits != 0 && !found; bits &= ~BandBit(band)) {
+            band = HighestBand(bits);
+            found = TakeShared(rng, nullptr, home, band, t);
+        }
+        if (!found) {
+            return false;
+        }
+
+        m_helperServed[TierOf(band)].fetch_add(1, std::memory_order_relaxed);
+        Detail::Trace(Detail::TraceEvent::Dequeue, t.GetTraceId(), t.GetTaskId(), static_cast<uint32_t>(band));
+        if constexpr (kMetricsEnabled) {
+            const int64_t queuedAt = t.GetQueuedAt();
+            const int64_t start = Detail::MetricsNow();
+            RunTask(t);
+            m_externalMetrics.Executed(band, queuedAt, start, Detail::MetricsNow());
+        }
+        else {
+            RunTask(t);
+        }
+        return true;
     }
 
     std::expected<TaskResult, CThreaderError> ThreadPool::GetResult(uint64_t _taskId) noexcept {
-        if (_taskId >= m_resultsSize.load(std::memory_order_acquire)) {
-            return std::unexpected(CThreaderError::TaskNotFound);
+        return m_results.Get(_taskId);
+    }
+
+    std::expected<TaskResult, CThreaderError> ThreadPool::TakeResult(uint64_t _taskId) noexcept {
+        return m_results.Take(_taskId);
+    }
+
+    size_t ThreadPool::CountStalled() const noexcept {
+        const int64_t now = std::chrono::steady_clock::now().time_since_epoch().count();
+        const int64_t limit = std::chrono::duration_cast<std::chrono::steady_clock::duration>(m_elastic.stallAfter).count();
+        size_t stalled = 0;
+        for (const auto& w : m_workers) {
+            const int64_t since = w->busySince.load(std::memory_order_relaxed);
+            if (since != 0 && now - since > limit && !w->blocking.load(std::memory_order_relaxed)) {
+                ++stalled;
+            }
+        }
+        return stalled;
+    }
+
+    bool ThreadPool::Compensate() noexcept {
+        const size_t blocked = m_blocked.load(std::memory_order_relaxed) + m_stalled.load(std::memory_order_relaxed);
+        size_t compensating = m_compensating.load(std::memory_order_relaxed);
+        do {
+            if (compensating >= blocked || compensating >= m_elastic.maxCompensation) {
+                return false;
+            }
+        } while (!m_compensating.compare_exchange_weak(compensating, compensating + 1, std::memory_order_relaxed));
+
+        try {
+            if (AddWorker()) {
+                return true;
+            }
+        }
+        catch (...) {
+        }
+        m_compensating.fetch_sub(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    bool ThreadPool::HasSurplus() const noexcept {
+        return m_compensating.load(std::memory_order_relaxed)
+            > m_blocked.load(std::memory_order_relaxed) + m_stalled.load(std::memory_order_relaxed);
+    }
+
+    bool ThreadPool::RetireSurplus(Worker& _self) noexcept {
+        // Any worker may retire in place of the compensation worker: slots
+        // are interchangeable, and this one is at a task boundary already.
+        const size_t blocked = m_blocked.load(std::memory_order_relaxed) + m_stalled.load(std::memory_order_relaxed);
+        size_t compensating = m_compensating.load(std::memory_order_relaxed);
+        do {
+            if (compensating <= blocked) {
+                return false;
+            }
+        } while (!m_compensating.compare_exchange_weak(compensating, compensating - 1, std::memory_order_relaxed));
+
+        // If keep-alive already took the pool down to its floor, the surplus
+        // is gone and this worker stays.
+        size_t active = m_active.load(std::memory_order_relaxed);
+        do {
+            if (active <= m_elastic.minThreads) {
+                return false;
+            }
+        } while (!m_active.compare_exchange_weak(active, active - 1, std::memory_order_relaxed));
+
+        // Hand nested work left on this worker to its node's global queues.
+        size_t moved = 0;
+        Task* node = nullptr;
+        for (uint64_t bits = _self.localBits.load(std::memory_order_relaxed); bits != 0; bits &= bits - 1) {
+            const size_t band = static_cast<size_t>(std::countr_zero(bits));
+            while (_self.local[band].pop(node)) {
+                PushGlobal(_self.node, band, node, 1);
+                ReleaseNode(node);
+                ++moved;
+            }
+        }
+        _self.localBits.store(0, std::memory_order_relaxed);
+        WakeWorkers(moved);
+
+        _self.active.store(false, std::memory_order_release);
+        return true;
+    }
+
+    void ThreadPool::BeginBlocking() noexcept {
+        if (t_worker.pool != this || t_blockingDepth++ != 0) {
+            return;
+        }
+
+        m_workers[t_worker.index]->blocking.store(true, std::memory_order_relaxed);
+        m_blocked.fetch_add(1, std::memory_order_relaxed);
+        // A parked worker can take over this one's share as it is.
+        if (m_sleepers.load(std::memory_order_relaxed) == 0) {
+            Compensate();
+        }
+    }
+
+    void ThreadPool::EndBlocking() noexcept {
+        if (t_worker.pool != this || t_blockingDepth == 0 || --t_blockingDepth != 0) {
+            return;
+        }
+
+        m_workers[t_worker.index]->blocking.store(false, std::memory_order_relaxed);
+        m_blocked.fetch_sub(1, std::memory_order_relaxed);
+        // Busy workers retire the surplus at their next task boundary; nudge
+        // a parked one in case everyone else is asleep.
+        if (HasSurplus()) {
+            WakeWorkers(1);
         }
+    }
 
-        const size_t shard = ShardOf(_taskId);
-        std::lock_guard<SpinLock> g(m_resultShards[shard].lock);
-        const TaskResult& slot = m_results[_taskId];
-        if (!slot.HasValue()) {
-            return std::unexpected(CThreaderError::TaskNotFound);
+    uint64_t ThreadPool::TimerTick(std::chrono::steady_clock::time_point _time, bool _roundUp) const noexcept {
+        if (_time <= m_timerEpoch) {
+            return 0;
         }
+        const auto elapsed = _time - m_timerEpoch;
+        const auto ticks = static_cast<uint64_t>(elapsed / kTimerTick);
+        // Rounded up for due times so a timer never fires early.
+        return ticks + (_roundUp && elapsed % kTimerTick != std::chrono::steady_clock::duration::zero() ? 1 : 0);
+    }
+
+    TimerId ThreadPool::AddTimer(Task&& _task, TaskLevel _taskLevel, std::chrono::steady_clock::time_point _due, std::chrono::steady_clock::duration _interval) noexcept {
+        const uint64_t interval = _interval <= std::chrono::steady_clock::duration::zero()
+            ? 0 : std::max<uint64_t>(TimerTick(m_timerEpoch + _interval, true), 1);
+
+        std::lock_guard lock(m_timerMutex);
+        const TimerId id = m_timers.Add(std::move(_task), _taskLevel, TimerTick(_due, true), interval);
+        if (m_timersEnabled && !m_timerThread.joinable()) {
+            m_timerThread = std::jthread([this](std::stop_token st) {
+                TimerLoop(st);
+            });
+        }
+        else if (m_timers.NextExpiry() < m_timerDeadline) {
+            m_timerKick = true;
+            m_timerCv.notify_one();
+        }
+        return id;
+    }
+
+    bool ThreadPool::CancelTimer(TimerId _id) noexcept {
+        // The timer thread just sleeps through a slot that emptied.
+        std::lock_guard lock(m_timerMutex);
+        return m_timers.Cancel(_id);
+    }
 
-        return slot;
+    void ThreadPool::RearmTimer(TimerId _id) noexcept {
+        const uint64_t now = TimerTick(std::chrono::steady_clock::now(), false);
+        std::lock_guard lock(m_timerMutex);
+        if (m_timers.Rearm(_id, now) && m_timers.NextExpiry() < m_timerDeadline) {
+            m_timerKick = true;
+            m_timerCv.notify_one();
+        }
+    }
+
+    void ThreadPool::TimerLoop(std::stop_token _st) {
+        std::vector<TimerWheel::Fired> fired;
+        std::unique_lock lock(m_timerMutex);
+        while (!_st.stop_requested()) {
+            m_timers.Advance(TimerTick(std::chrono::steady_clock::now(), false), fired);
+            if (!fired.empty()) {
+                lock.unlock();
+                for (auto& f : fired) {
+                    if (f.periodic) {
+                        // The next period is only armed once this run is over,
+                        // so runs of one timer never overlap.
+                        PushTask(Task([this, id = f.id, task = std::move(f.periodic)] {
+                            try {
+                                task->Execute();
+                            }
+                            catch (...) {
+                                RearmTimer(id);
+                                throw;
+                            }
+                            RearmTimer(id);
+                        }), f.level);
+                    }
+                    else {
+                        PushTask(std::move(f.task), f.level);
+                    }
+                }
+                fired.clear();
+                lock.lock();
+                continue;
+            }
+
+            m_timerKick = false;
+            const std::optional<uint64_t> next = m_timers.NextExpiry();
+            m_timerDeadline = next.value_or(UINT64_MAX);
+            if (next) {
+                m_timerCv.wait_until(lock, _st, m_timerEpoch + *next * kTimerTick, [this] { return m_timerKick; });
+            }
+            else {
+                m_timerCv.wait(lock, _st, [this] { return m_timerKick; });
+            }
+        }
+        m_timerDeadline = UINT64_MAX;
     }
-}
+}
\ No newline at end of file
@@ -0,0 +1,227 @@
+#include "CThreader/TimerWheel.hpp"
+#include <algorithm>
+#include <bit>
+#include <limits>
+
+namespace CT {
+    namespace {
+        constexpr uint64_t kMask = TimerWheel::kSlots - 1;
+        // Ticks covered by the whole wheel.
+        constexpr uint64_t kSpan = uint64_t(1) << (TimerWheel::kBits * TimerWheel::kLevels);
+    }
+
+    TimerId TimerWheel::MakeId(uint32_t _index, uint32_t _generation) noexcept {
+        return (static_cast<uint64_t>(_generation) << 32) | (static_cast<uint64_t>(_index) + 1);
+    }
+
+    TimerWheel::Entry* TimerWheel::Find(TimerId _id) noexcept {
+        const uint64_t low = _id & 0xFFFFFFFFull;
+        if (low == 0 || low > m_entries.size()) {
+            return nullptr;
+        }
+        Entry& e = m_entries[low - 1];
+        if (e.state == State::Free || e.generation != static_cast<uint32_t>(_id >> 32)) {
+            return nullptr;
+        }
+        return &e;
+    }
+
+    TimerId TimerWheel::Add(Task&& _task, TaskLevel _taskLevel, uint64_t _due, uint64_t _interval) {
+        uint32_t index;
+        if (!m_free.empty()) {
+            index = m_free.back();
+            m_free.pop_back();
+        }
+        else {
+            index = static_cast<uint32_t>(m_entries.size());
+            m_entries.emplace_back();
+        }
+
+        Entry& e = m_entries[index];
+        if (_interval == 0) {
+            e.task = std::move(_task);
+        }
+        else {
+            e.periodic = std::make_shared<Task>(std::move(_task));
+        }
+        e.due = std::max(_due, m_now + 1);
+        e.interval = _interval;
+        e.level = _taskLevel;
+        e.state = State::Pending;
+        ++m_live;
+        Link(index);
+        return MakeId(index, e.generation);
+    }
+
+    bool TimerWheel::Cancel(TimerId _id) noexcept {
+        Entry* e = Find(_id);
+        if (!e) {
+            return false;
+        }
+        const uint32_t index = static_cast<uint32_t>(e - m_entries.data());
+        if (e->state == State::Pending) {
+            Unlink(index);
+        }
+        Free(index);
+        return true;
+    }
+
+    bool TimerWheel::Rearm(TimerId _id, uint64_t _now) noexcept {
+        Entry* e = Find(_id);
+        if (!e || e->state != State::Running) {
+            return false;
+        }
+        const uint64_t now = std::max(_now, m_now);
+        e->due += e->interval;
+        if (e->due <= now) {
+            e->due = now + e->interval;
+        }
+        e->state = State::Pending;
+        Link(static_cast<uint32_t>(e - m_entries.data()));
+        return true;
+    }
+
+    void TimerWheel::Link(uint32_t _index) noexcept {
+        Entry& e = m_entries[_index];
+        // Level l takes due ticks [kSlots^l, kSlots^(l+1)) ahead; a slot of
+        // level l is reached when the ticks above its bits line up.
+        const uint64_t delta = e.due - m_now;
+        uint64_t at = e.due;
+        uint32_t level = 0;
+        if (delta >= kSpan) {
+            at = m_now + kSpan - 1;
+            level = kLevels - 1;
+        }
+        else {
+            while (level + 1 < kLevels && delta >= (uint64_t(1) << (kBits * (level + 1)))) {
+                ++level;
+            }
+        }
+
+        const uint32_t slot = static_cast<uint32_t>((at >> (kBits * level)) & kMask);
+        e.slot = static_cast<uint16_t>(level * kSlots + slot);
+        e.prev = kNil;
+        e.next = m_heads[e.slot];
+        if (e.next != kNil) {
+            m_entries[e.next].prev = _index;
+        }
+        m_heads[e.slot] = _index;
+        m_occupied[level] |= uint64_t(1) << slot;
+        ++m_linked;
+    }
+
+    void TimerWheel::Unlink(uint32_t _index) noexcept {
+        Entry& e = m_entries[_index];
+        if (e.prev != kNil) {
+            m_entries[e.prev].next = e.next;
+        }
+        else {
+            m_heads[e.slot] = e.next;
+        }
+        if (e.next != kNil) {
+            m_entries[e.next].prev = e.prev;
+        }
+        if (m_heads[e.slot] == kNil) {
+            m_occupied[e.slot / kSlots] &= ~(uint64_t(1) << (e.slot % kSlots));
+        }
+        e.prev = e.next = kNil;
+        --m_linked;
+    }
+
+    void TimerWheel::Free(uint32_t _index) noexcept {
+        Entry& e = m_entries[_index];
+        e.task = Task{};
+        e.periodic.reset();
+        e.state = State::Free;
+        ++e.generation;
+        --m_live;
+        m_free.push_back(_index);
+    }
+
+    void TimerWheel::Cascade(uint32_t _level) noexcept {
+        const uint32_t slot = _level * kSlots + static_cast<uint32_t>((m_now >> (kBits * _level)) & kMask);
+        uint32_t index = m_heads[slot];
+        m_heads[slot] = kNil;
+        m_occupied[_level] &= ~(uint64_t(1) << (slot % kSlots));
+        while (index != kNil) {
+            const uint32_t next = m_entries[index].next;
+            --m_linked;
+            Link(index);
+            index = next;
+        }
+    }
+
+    void TimerWheel::Expire(std::vector<Fired>& _out) {
+        const uint32_t slot = static_cast<uint32_t>(m_now & kMask);
+        uint32_t index = m_heads[slot];
+        m_heads[slot] = kNil;
+        m_occupied[0] &= ~(uint64_t(1) << slot);
+        while (index != kNil) {
+            Entry& e = m_entries[index];
+            const uint32_t next = e.next;
+            e.prev = e.next = kNil;
+            --m_linked;
+
+            Fired& fired = _out.emplace_back();
+            fired.id = MakeId(index, e.generation);
+            fired.level = e.level;
+            if (e.interval == 0) {
+                fired.task = std::move(e.task);
+                Free(index);
+            }
+            else {
+                fired.periodic = e.periodic;
+                e.state = State::Running;
+            }
+            index = next;
+        }
+    }
+
+    void TimerWheel::Advance(uint64_t _now, std::vector<Fired>& _out) {
+        while (m_now < _now) {
+            if (m_linked == 0) {
+                m_now = _now;
+                break;
+            }
+
+            // Ticks before the next fire or cascade have nothing to do.
+            m_now = std::min(*NextExpiry(), _now);
+            for (uint32_t level = kLevels - 1; level > 0; --level) {
+                if ((m_now & ((uint64_t(1) << (kBits * level)) - 1)) == 0) {
+                    Cascade(level);
+                }
+            }
+            Expire(_out);
+        }
+    }
+
+    std::optional<uint64_t> TimerWheel::NextExpiry() const noexcept {
+        if (m_linked == 0) {
+            return std::nullopt;
+        }
+
+        uint64_t best = std::numeric_limits<uint64_t>::max();
+        for (uint32_t level = 0; level < kLevels; ++level) {
+            if (m_occupied[level] == 0) {
+                continue;
+            }
+            // Distance, 1..kSlots, from the current slot to the next occupied one.
+            const uint64_t base = m_now >> (kBits * level);
+            const int shift = static_cast<int>((base + 1) & kMask);
+            const uint64_t distance = static_cast<uint64_t>(std::countr_zero(std::rotr(m_occupied[level], shift))) + 1;
+            best = std::min(best, (base + distance) << (kBits * level));
+        }
+        return best;
+    }
+
+    void TimerWheel::Clear() noexcept {
+        for (uint32_t index = 0; index < m_entries.size(); ++index) {
+            if (m_entries[index].state != State::Free) {
+                Free(index);
+            }
+        }
+        m_heads = MakeHeads();
+        m_occupied = {};
+        m_linked = 0;
+    }
+}
@@ -0,0 +1,196 @@
+#include "CThreader/Topology.hpp"
+#include <algorithm>
+#include <fstream>
+#include <string>
+#include <cctype>
+
+#if defined(_WIN32)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#elif defined(__linux__)
+#include <sched.h>
+#include <filesystem>
+#endif
+
+namespace CT {
+#if defined(__linux__)
+    // Parses a sysfs cpulist such as "0-3,8-11".
+    static std::vector<uint32_t> ParseCpuList(const std::string& _list) {
+        std::vector<uint32_t> cpus;
+        size_t pos = 0;
+        while (pos < _list.size()) {
+            const size_t end = std::min(_list.find(',', pos), _list.size());
+            const std::string part = _list.substr(pos, end - pos);
+            const size_t dash = part.find('-');
+            try {
+                const uint32_t first = static_cast<uint32_t>(std::stoul(part.substr(0, dash)));
+                const uint32_t last = dash == std::string::npos ? first : static_cast<uint32_t>(std::stoul(part.substr(dash + 1)));
+                for (uint32_t cpu = first; cpu <= last; ++cpu) {
+                    cpus.push_back(cpu);
+                }
+            }
+            catch (...) {
+                // Blank or malformed piece (e.g. trailing newline): skip it.
+            }
+            pos = end + 1;
+        }
+        return cpus;
+    }
+
+    static std::string ReadLine(const std::filesystem::path& _path) {
+        std::ifstream in(_path);
+        std::string line;
+        std::getline(in, line);
+        return line;
+    }
+
+    static std::vector<NumaNode> DiscoverNodes() {
+        cpu_set_t allowed;
+        CPU_ZERO(&allowed);
+        const bool haveMask = sched_getaffinity(0, sizeof(allowed), &allowed) == 0;
+        const auto usable = [&](uint32_t _cpu) {
+            return !haveMask || (_cpu < CPU_SETSIZE && CPU_ISSET(_cpu, &allowed));
+        };
+
+        std::vector<NumaNode> nodes;
+        std::error_code ec;
+        for (const auto& entry : std::filesystem::directory_iterator("/sys/devices/system/node", ec)) {
+            const std::string name = entry.path().filename().string();
+            if (name.rfind("node", 0) != 0 || name.size() == 4 || !std::all_of(name.begin() + 4, name.end(), ::isdigit)) {
+                continue;
+            }
+
+            NumaNode node;
+            node.id = static_cast<uint32_t>(std::stoul(name.substr(4)));
+            for (uint32_t cpu : ParseCpuList(ReadLine(entry.path() / "cpulist"))) {
+                if (usable(cpu)) {
+                    node.cpus.push_back(cpu);
+                }
+            }
+            if (!node.cpus.empty()) {
+                nodes.push_back(std::move(node));
+            }
+        }
+
+        std::sort(nodes.begin(), nodes.end(), [](const NumaNode& _a, const NumaNode& _b) { return _a.id < _b.id; });
+
+        if (nodes.empty()) {
+            // No NUMA support compiled in: treat the machine as one node.
+            NumaNode node;
+            for (uint32_t cpu : ParseCpuList(ReadLine("/sys/devices/system/cpu/online"))) {
+                if (usable(cpu)) {
+                    node.cpus.push_back(cpu);
+                }
+            }
+            if (!node.cpus.empty()) {
+                nodes.push_back(std::move(node));
+            }
+        }
+        return nodes;
+    }
+
+    std::optional<uint32_t> Topology::CurrentCpu() noexcept {
+        const int cpu = sched_getcpu();
+        if (cpu < 0) {
+            return std::nullopt;
+        }
+        return static_cast<uint32_t>(cpu);
+    }
+
+    bool Topology::PinCurrentThread(uint32_t _cpu) noexcept {
+        if (_cpu >= CPU_SETSIZE) {
+            return false;
+        }
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(_cpu, &set);
+        return sched_setaffinity(0, sizeof(set), &set) == 0;
+    }
+#elif defined(_WIN32)
+    // CPU ids are group * 64 + number within the group.
+    static std::vector<NumaNode> DiscoverNodes() {
+        std::vector<NumaNode> nodes;
+        ULONG highest = 0;
+        if (!GetNumaHighestNodeNumber(&highest)) {
+            return nodes;
+        }
+
+        for (USHORT id = 0; id <= highest; ++id) {
+            GROUP_AFFINITY affinity{};
+            if (!GetNumaNodeProcessorMaskEx(id, &affinity)) {
+                continue;
+            }
+
+            NumaNode node;
+            node.id = id;
+            for (uint32_t bit = 0; bit < 64; ++bit) {
+                if (affinity.Mask & (KAFFINITY(1) << bit)) {
+                    node.cpus.push_back(static_cast<uint32_t>(affinity.Group) * 64 + bit);
+                }
+            }
+            if (!node.cpus.empty()) {
+                nodes.push_back(std::move(node));
+            }
+        }
+        return nodes;
+    }
+
+    std::optional<uint32_t> Topology::CurrentCpu() noexcept {
+        PROCESSOR_NUMBER number{};
+        GetCurrentProcessorNumberEx(&number);
+        return static_cast<uint32_t>(number.Group) * 64 + number.Number;
+    }
+
+    bool Topology::PinCurrentThread(uint32_t _cpu) noexcept {
+        GROUP_AFFINITY affinity{};
+        affinity.Group = static_cast<WORD>(_cpu / 64);
+        affinity.Mask = KAFFINITY(1) << (_cpu % 64);
+        return SetThreadGroupAffinity(GetCurrentThread(), &affinity, nullptr) != 0;
+    }
+#else
+    static std::vector<NumaNode> DiscoverNodes() {
+        return {};
+    }
+
+    std::optional<uint32_t> Topology::CurrentCpu() noexcept {
+        return std::nullopt;
+    }
+
+    bool Topology::PinCurrentThread(uint32_t) noexcept {
+        return false;
+    }
+#endif
+
+    Topology Topology::Discover() noexcept {
+        Topology topology;
+        try {
+            topology.m_nodes = DiscoverNodes();
+            for (size_t i = 0; i < topology.m_nodes.size(); ++i) {
+                for (uint32_t cpu : topology.m_nodes[i].cpus) {
+                    if (cpu >= topology.m_cpuNode.size()) {
+                        topology.m_cpuNode.resize(cpu + 1, 0);
+                    }
+                    topology.m_cpuNode[cpu] = static_cast<uint32_t>(i);
+                }
+            }
+        }
+        catch (...) {
+            topology = Topology{};
+        }
+        return topology;
+    }
+
+    size_t Topology::CpuCount() const noexcept {
+        size_t count = 0;
+        for (const auto& node : m_nodes) {
+            count += node.cpus.size();
+        }
+        return count;
+    }
+
+    size_t Topology::NodeOfCpu(uint32_t _cpu) const noexcept {
+        return _cpu < m_cpuNode.size() ? m_cpuNode[_cpu] : 0;
+    }
+}
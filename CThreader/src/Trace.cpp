@@ -0,0 +1,293 @@
+#include "CThreader/Trace.hpp"
+#include <algorithm>
+#include <bit>
+#include <chrono>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace CT {
+#if CTHREADER_ENABLE_TRACING
+    namespace {
+        using Detail::TraceEvent;
+        using Detail::kTraceSameLevel;
+
+        // Single-writer ring of one thread. WriteTrace reads it while the
+        // owner keeps writing, so the slots are relaxed atomics and the reader
+        // re-checks head afterwards to drop slots that were being reused.
+        struct Ring {
+            struct Slot {
+                std::atomic<int64_t> time{ 0 };
+                std::atomic<uint64_t> traceId{ 0 };
+                std::atomic<uint64_t> taskId{ 0 };
+                // event << 32 | level
+                std::atomic<uint64_t> meta{ 0 };
+            };
+
+            Ring(size_t _capacity, uint32_t _tid, uint32_t _epoch, int32_t _worker)
+                : slots(std::make_unique<Slot[]>(_capacity)), mask(_capacity - 1), tid(_tid), epoch(_epoch), worker(_worker) {}
+
+            std::unique_ptr<Slot[]> slots;
+            const size_t mask;
+            const uint32_t tid;
+            const uint32_t epoch;
+            const int32_t worker;
+            std::atomic<uint64_t> head{ 0 };
+            // Owner-only.
+            uint64_t nextSeq{ 0 };
+            uint32_t lastLevel{ 0 };
+        };
+
+        struct Event {
+            int64_t time;
+            uint64_t traceId;
+            uint64_t taskId;
+            TraceEvent event;
+            uint32_t level;
+        };
+
+        std::mutex s_mutex;
+        // Rings of the current session, one per thread that recorded in it.
+        std::vector<std::shared_ptr<Ring>> s_rings;
+        // Rings of this session whose thread has exited. The next thread in
+        // the same worker slot (or the next non-worker thread) carries on in
+        // one, so elastic workers coming and going do not add rings.
+        std::vector<std::shared_ptr<Ring>> s_free;
+        size_t s_capacity{ size_t(1) << 15 };
+        uint32_t s_nextTid{ 0 };
+        std::atomic<uint32_t> s_epoch{ 0 };
+        std::atomic<int64_t> s_origin{ 0 };
+
+        // Hands the thread's ring back on exit. Later threads keep its lane,
+        // which is fine since the two never record at the same time.
+        struct RingHolder {
+            ~RingHolder() {
+                if (ring && ring->epoch == s_epoch.load(std::memory_order_acquire)) {
+                    std::lock_guard lock(s_mutex);
+                    if (ring->epoch == s_epoch.load(std::memory_order_relaxed)) {
+                        s_free.push_back(std::move(ring));
+                    }
+                }
+            }
+
+            std::shared_ptr<Ring> ring;
+        };
+
+        thread_local RingHolder t_ring;
+        thread_local int32_t t_workerIndex{ -1 };
+
+        Ring* CurrentRing() noexcept {
+            Ring* ring = t_ring.ring.get();
+            const uint32_t epoch = s_epoch.load(std::memory_order_acquire);
+            if (ring && ring->epoch == epoch) {
+                return ring;
+            }
+
+            // First event of this thread since StartTracing.
+            try {
+                std::lock_guard lock(s_mutex);
+                const auto reuse = std::find_if(s_free.begin(), s_free.end(), [](const std::shared_ptr<Ring>& _ring) {
+                    return _ring->worker == t_workerIndex && _ring->epoch == s_epoch.load(std::memory_order_relaxed);
+                });
+                if (reuse != s_free.end()) {
+                    t_ring.ring = std::move(*reuse);
+                    s_free.erase(reuse);
+                }
+                else {
+                    auto fresh = std::make_shared<Ring>(s_capacity, s_nextTid++, s_epoch.load(std::memory_order_relaxed), t_workerIndex);
+                    s_rings.push_back(fresh);
+                    t_ring.ring = std::move(fresh);
+                }
+                return t_ring.ring.get();
+            }
+            catch (...) {
+                return nullptr;
+            }
+        }
+
+        void Snapshot(const Ring& _ring, std::vector<Event>& _out) {
+            const size_t capacity = _ring.mask + 1;
+            const uint64_t head = _ring.head.load(std::memory_order_acquire);
+            const uint64_t first = head > capacity ? head - capacity : 0;
+
+            const size_t base = _out.size();
+            for (uint64_t i = first; i < head; ++i) {
+                const Ring::Slot& slot = _ring.slots[i & _ring.mask];
+                const uint64_t meta = slot.meta.load(std::memory_order_relaxed);
+                _out.push_back(Event{
+                    slot.time.load(std::memory_order_relaxed),
+                    slot.traceId.load(std::memory_order_relaxed),
+                    slot.taskId.load(std::memory_order_relaxed),
+                    static_cast<TraceEvent>(meta >> 32),
+                    static_cast<uint32_t>(meta) });
+            }
+
+            // The owner may have lapped the oldest slots while they were read.
+            std::atomic_thread_fence(std::memory_order_acquire);
+            const uint64_t now = _ring.head.load(std::memory_order_relaxed);
+            const uint64_t valid = now >= capacity ? now - capacity + 1 : 0;
+            if (valid > first) {
+                const size_t drop = static_cast<size_t>(std::min<uint64_t>(valid - first, head - first));
+                _out.erase(_out.begin() + static_cast<std::ptrdiff_t>(base), _out.begin() + static_cast<std::ptrdiff_t>(base + drop));
+            }
+        }
+
+        // Microseconds since StartTracing with ns precision, as the format wants.
+        void WriteTime(std::ofstream& _out, int64_t _ticks) {
+            const auto since = std::chrono::steady_clock::duration(std::max<int64_t>(_ticks - s_origin.load(std::memory_order_relaxed), 0));
+            const auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(since).count();
+            const std::string fraction = std::to_string(ns % 1000);
+            _out << ns / 1000 << '.' << std::string(3 - fraction.size(), '0') << fraction;
+        }
+
+        void WriteLevel(std::ofstream& _out, uint32_t _level) {
+            if (_level < kPriorityBands) {
+                _out << _level;
+            }
+            else {
+                _out << "\"deadline\"";
+            }
+        }
+    }
+
+    namespace Detail {
+        void TraceRecord(TraceEvent _event, uint64_t _traceId, uint64_t _taskId, uint32_t _level) noexcept {
+            Ring* ring = CurrentRing();
+            if (!ring) {
+                return;
+            }
+
+            if (_event == TraceEvent::Dequeue) {
+                ring->lastLevel = _level;
+            }
+            else if (_level == kTraceSameLevel) {
+                _level = ring->lastLevel;
+            }
+
+            const uint64_t head = ring->head.load(std::memory_order_relaxed);
+            Ring::Slot& slot = ring->slots[head & ring->mask];
+            slot.time.store(std::chrono::steady_clock::now().time_since_epoch().count(), std::memory_order_relaxed);
+            slot.traceId.store(_traceId, std::memory_order_relaxed);
+            slot.taskId.store(_taskId, std::memory_order_relaxed);
+            slot.meta.store(static_cast<uint64_t>(_event) << 32 | _level, std::memory_order_relaxed);
+            ring->head.store(head + 1, std::memory_order_release);
+        }
+
+        uint64_t TraceNextId() noexcept {
+            Ring* ring = CurrentRing();
+            if (!ring) {
+                return 0;
+            }
+            // Unique per session without a shared counter: thread, then sequence.
+            return (static_cast<uint64_t>(ring->tid) + 1) << 40 | ++ring->nextSeq;
+        }
+
+        void TraceSetWorker(uint32_t _index) noexcept {
+            t_workerIndex = static_cast<int32_t>(_index);
+        }
+    }
+
+    void StartTracing(size_t _eventsPerThread) {
+        std::lock_guard lock(s_mutex);
+        Detail::g_tracing.store(false, std::memory_order_relaxed);
+        s_capacity = std::bit_ceil(std::max<size_t>(_eventsPerThread, 64));
+        s_rings.clear();
+        s_free.clear();
+        s_nextTid = 0;
+        s_origin.store(std::chrono::steady_clock::now().time_since_epoch().count(), std::memory_order_relaxed);
+        s_epoch.fetch_add(1, std::memory_order_release);
+        Detail::g_tracing.store(true, std::memory_order_release);
+    }
+
+    void StopTracing() noexcept {
+        Detail::g_tracing.store(false, std::memory_order_release);
+    }
+
+    bool WriteTrace(const std::filesystem::path& _path) {
+        std::vector<std::shared_ptr<Ring>> rings;
+        {
+            std::lock_guard lock(s_mutex);
+            rings = s_rings;
+        }
+
+        std::ofstream out(_path, std::ios::binary | std::ios::trunc);
+        if (!out) {
+            return false;
+        }
+
+        out << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n";
+        bool first = true;
+        const auto begin = [&] {
+            out << (first ? "" : ",\n");
+            first = false;
+        };
+
+        std::vector<Event> events;
+        for (const auto& ring : rings) {
+            begin();
+            out << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << ring->tid << ",\"args\":{\"name\":\"";
+            if (ring->worker >= 0) {
+                out << "worker " << ring->worker;
+            }
+            else {
+                out << "thread " << ring->tid;
+            }
+            out << "\"}}";
+
+            events.clear();
+            Snapshot(*ring, events);
+            for (const Event& e : events) {
+                // Enqueue and Dequeue are instants on the thread that did them;
+                // a flow arrow links the enqueue to the slice of the run.
+                begin();
+                switch (e.event) {
+                case TraceEvent::Enqueue:
+                case TraceEvent::Dequeue:
+                    out << "{\"name\":\"" << (e.event == TraceEvent::Enqueue ? "enqueue" : "dequeue") << "\",\"cat\":\"task\",\"ph\":\"i\",\"s\":\"t\"";
+                    break;
+                case TraceEvent::Start:
+                    out << "{\"name\":\"task\",\"cat\":\"task\",\"ph\":\"B\"";
+                    break;
+                case TraceEvent::Finish:
+                    out << "{\"ph\":\"E\"";
+                    break;
+                }
+                out << ",\"pid\":1,\"tid\":" << ring->tid << ",\"ts\":";
+                WriteTime(out, e.time);
+                if (e.event != TraceEvent::Finish) {
+                    out << ",\"args\":{\"task\":" << e.taskId << ",\"trace\":" << e.traceId << ",\"level\":";
+                    WriteLevel(out, e.level);
+                    if (ring->worker >= 0) {
+                        out << ",\"worker\":" << ring->worker;
+                    }
+                    out << '}';
+                }
+                out << '}';
+
+                if (e.traceId != 0 && (e.event == TraceEvent::Enqueue || e.event == TraceEvent::Start)) {
+                    begin();
+                    out << "{\"name\":\"task\",\"cat\":\"flow\",\"ph\":\"" << (e.event == TraceEvent::Enqueue ? "s" : "f\",\"bp\":\"e")
+                        << "\",\"id\":" << e.traceId << ",\"pid\":1,\"tid\":" << ring->tid << ",\"ts\":";
+                    WriteTime(out, e.time);
+                    out << '}';
+                }
+            }
+        }
+
+        out << "\n]}\n";
+        return static_cast<bool>(out);
+    }
+#else
+    void StartTracing(size_t) {}
+
+    void StopTracing() noexcept {}
+
+    bool WriteTrace(const std::filesystem::path& _path) {
+        std::ofstream out(_path, std::ios::binary | std::ios::trunc);
+        out << "{\"traceEvents\":[]}\n";
+        return static_cast<bool>(out);
+    }
+#endif
+}
@@ -0,0 +1,552 @@
+// main.cpp
+// cthreader_bench: pool throughput, enqueue-to-start latency, strong and weak
+// scaling of the 15 Workloads, and the same jobs on std::async. Prints a
+// summary and writes every number to a JSON file so runs can be compared
+// across versions.
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <functional>
+#include <future>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "CThreader/CThreader.hpp"
+
+#include "DemoTasks.hpp"
+
+#ifndef CTHREADER_BENCH_BUILD_TYPE
+#define CTHREADER_BENCH_BUILD_TYPE "unknown"
+#endif
+
+namespace {
+    using Clock = std::chrono::steady_clock;
+
+    struct Options {
+        size_t maxThreads{ std::max<size_t>(std::thread::hardware_concurrency(), 1) };
+        size_t repeat{ 3 };
+        double scale{ 1.0 };
+        size_t emptyTasks{ 1'000'000 };
+        size_t latencySamples{ 20'000 };
+        std::string out{ "cthreader_bench.json" };
+        std::string only;
+        bool scaling{ true };
+        bool async{ true };
+    };
+
+    struct Workload {
+        std::string name;
+        // Returns something derived from the result so the work is not
+        // optimized away.
+        std::function<uint64_t()> run;
+    };
+
+    struct Throughput {
+        size_t threads{ 0 };
+        size_t tasks{ 0 };
+        double post{ 0 };
+        double postBatch{ 0 };
+        double enqueue{ 0 };
+        size_t asyncTasks{ 0 };
+        double async{ 0 };
+    };
+
+    struct Latency {
+        std::string mode;
+        size_t samples{ 0 };
+        // Nanoseconds.
+        double mean{ 0 };
+        int64_t p50{ 0 }, p90{ 0 }, p99{ 0 }, p999{ 0 }, max{ 0 };
+    };
+
+    struct ScalingPoint {
+        size_t threads{ 0 };
+        size_t jobs{ 0 };
+        double seconds{ 0 };
+    };
+
+    struct WorkloadResult {
+        std::string name;
+        double serialSeconds{ 0 };
+        std::vector<ScalingPoint> strong;
+        std::vector<ScalingPoint> weak;
+        size_t compareJobs{ 0 };
+        double poolSeconds{ 0 };
+        double asyncSeconds{ 0 };
+    };
+
+    std::atomic<uint64_t> g_sink{ 0 };
+
+    double Seconds(Clock::duration _elapsed) {
+        return std::chrono::duration<double>(_elapsed).count();
+    }
+
+    // Best of _repeat runs: the least disturbed one.
+    template<typename Fn>
+    double BestOf(size_t _repeat, Fn&& _fn) {
+        double best = 0;
+        for (size_t i = 0; i < _repeat; ++i) {
+            const auto begin = Clock::now();
+            _fn();
+            const double elapsed = Seconds(Clock::now() - begin);
+            best = i == 0 ? elapsed : std::min(best, elapsed);
+        }
+        return best;
+    }
+
+    std::vector<size_t> ThreadCounts(size_t _max) {
+        std::vector<size_t> counts;
+        for (size_t t = 1; t < _max; t *= 2) {
+            counts.push_back(t);
+        }
+        counts.push_back(_max);
+        return counts;
+    }
+
+    template<typename T>
+    T Scaled(T _value, double _scale) {
+        return std::max<T>(static_cast<T>(static_cast<double>(_value) * _scale), 1);
+    }
+
+    // Same parameters as CThreaderTest, times _scale.
+    std::vector<Workload> MakeWorkloads(double _scale) {
+        using namespace Workloads;
+
+        const auto matrixA = std::make_shared<std::vector<double>>(GenerateRandomDoubleData(64 * 64, 42));
+        const auto matrixB = std::make_shared<std::vector<double>>(GenerateRandomDoubleData(64 * 64, 1337));
+        const auto kernel = std::make_shared<std::vector<double>>(GenerateRandomDoubleData(9, 123));
+        const auto largeData = std::make_shared<std::vector<int>>(GenerateRandomIntData(1'000'000, 42));
+        const auto sortData = std::make_shared<std::vector<int>>(GenerateRandomIntData(Scaled<size_t>(200'000, _scale), 777));
+        const auto dftInput = std::make_shared<std::vector<Complex>>(GenerateRandomComplexData(Scaled<size_t>(512, _scale), 42));
+        const auto grid = std::make_shared<std::vector<int>>(GenerateGrid(200, 200, 42));
+        const auto text = std::make_shared<std::string>(GenerateRandomString(Scaled<size_t>(2000, _scale), 123));
+
+        return {
+            { "task1_heavy_math", [n = Scaled(1'000'000LL, _scale)] {
+                return static_cast<uint64_t>(Task1_HeavyMath(n));
+            } },
+            { "task2_matrix_multiplication", [matrixA, matrixB] {
+                return static_cast<uint64_t>(Task2_MatrixMultiplication(64, *matrixA, *matrixB).size());
+            } },
+            { "task3_2d_convolution", [kernel, height = Scaled<size_t>(23, _scale)] {
+                std::vector<double> data = GenerateRandomDoubleData(32 * height, 42);
+                Task3_2DConvolution(32, height, data, *kernel, 3);
+                return static_cast<uint64_t>(data.size());
+            } },
+            { "task4_random_memory_access", [largeData, n = Scaled<size_t>(5'000'000, _scale)] {
+                return static_cast<uint64_t>(Task4_RandomMemoryAccess(*largeData, n, 12345));
+            } },
+            { "task5_crypto_mining_sim", [n = Scaled<size_t>(500'000, _scale)] {
+                return Task5_CryptoMiningSim(1000, n);
+            } },
+            { "task6_sort_and_search", [sortData] {
+                return static_cast<uint64_t>(Task6_SortAndSearch(*sortData));
+            } },
+            { "task7_prime_counter", [end = Scaled(200'000, _scale)] {
+                return static_cast<uint64_t>(Task7_PrimeCounter(2, end));
+            } },
+            { "task8_nbody_sim_step", [count = Scaled<size_t>(200, _scale)] {
+                std::vector<Particle> particles(count);
+                for (size_t i = 0; i < particles.size(); i++) {
+                    particles[i] = { double(i), double(i + 1), double(i + 2), 0.01, -0.02, 0.03, 1.0 };
+                }
+                Task8_NBodySimStep(particles, 0.01);
+                return static_cast<uint64_t>(particles[0].x);
+            } },
+            { "task9_monte_carlo_pi", [n = Scaled(5'000'000LL, _scale)] {
+                return static_cast<uint64_t>(Task9_MonteCarloPi(n, 9876));
+            } },
+            { "task10_recursive_fibonacci", [n = _scale < 1.0 ? 30 : 35] {
+                return static_cast<uint64_t>(Task10_RecursiveFibonacci(n));
+            } },
+            { "task11_mandelbrot", [iterations = Scaled(1000, _scale)] {
+                return static_cast<uint64_t>(Task11_Mandelbrot(500, 500, iterations).size());
+            } },
+            { "task12_naive_dft", [dftInput] {
+                return static_cast<uint64_t>(Task12_NaiveDFT(*dftInput).size());
+            } },
+            { "task13_pathfinding_bfs", [grid] {
+                return static_cast<uint64_t>(Task13_PathfindingBFS(*grid, 200, 200, 0, 39'999));
+            } },
+            { "task14_compression_sim", [text] {
+                return static_cast<uint64_t>(Task14_CompressionSim(*text).size());
+            } },
+            { "task15_sieve_of_eratosthenes", [n = Scaled(2'000'000, _scale)] {
+                return static_cast<uint64_t>(Task15_SieveOfEratosthenes(n).size());
+            } },
+        };
+    }
+
+    Throughput MeasureThroughput(const Options& _options) {
+        Throughput result;
+        result.threads = _options.maxThreads;
+        result.tasks = _options.emptyTasks;
+
+        CT::CThreader threader;
+        threader.Initialize(_options.maxThreads);
+        threader.Start();
+
+        const double count = static_cast<double>(_options.emptyTasks);
+        result.post = count / BestOf(_options.repeat, [&] {
+            for (size_t i = 0; i < _options.emptyTasks; ++i) {
+                threader.Post(CT::Task([] {}));
+            }
+            threader.WaitIdle();
+        });
+
+        std::vector<CT::Task> batch;
+        result.postBatch = count / BestOf(_options.repeat, [&] {
+            batch.clear();
+            batch.reserve(_options.emptyTasks);
+            for (size_t i = 0; i < _options.emptyTasks; ++i) {
+                batch.emplace_back([] {});
+            }
+            threader.PostBatch(batch);
+            threader.WaitIdle();
+        });
+
+        // Enqueue reserves a result slot; take the results so the slots are
+        // reused instead of piling up.
+        std::vector<uint64_t> ids(_options.emptyTasks);
+        result.enqueue = count / BestOf(_options.repeat, [&] {
+            for (size_t i = 0; i < _options.emptyTasks; ++i) {
+                ids[i] = threader.Enqueue(CT::Task([] {}));
+            }
+            threader.WaitIdle();
+            for (const uint64_t id : ids) {
+                (void)threader.TakeResult(id);
+            }
+        });
+
+        // One thread per task: only a few thousand, or this takes minutes.
+        result.asyncTasks = std::min<size_t>(_options.emptyTasks, 20'000);
+        std::vector<std::future<void>> futures(result.asyncTasks);
+        result.async = static_cast<double>(result.asyncTasks) / BestOf(_options.repeat, [&] {
+            for (auto& future : futures) {
+                future = std::async(std::launch::async, [] {});
+            }
+            for (auto& future : futures) {
+                future.get();
+            }
+        });
+        return result;
+    }
+
+    Latency Summarize(std::string _mode, std::vector<int64_t>& _samples) {
+        Latency latency;
+        latency.mode = std::move(_mode);
+        latency.samples = _samples.size();
+        if (_samples.empty()) {
+            return latency;
+        }
+
+        std::sort(_samples.begin(), _samples.end());
+        const auto at = [&](double _q) {
+            return _samples[std::min(_samples.size() - 1, static_cast<size_t>(_q * static_cast<double>(_samples.size())))];
+        };
+        double sum = 0;
+        for (const int64_t ns : _samples) {
+            sum += static_cast<double>(ns);
+        }
+        latency.mean = sum / static_cast<double>(_samples.size());
+        latency.p50 = at(0.50);
+        latency.p90 = at(0.90);
+        latency.p99 = at(0.99);
+        latency.p999 = at(0.999);
+        latency.max = _samples.back();
+        return latency;
+    }
+
+    // Push to first instruction of the task. "paced" leaves ~50us between
+    // pushes so workers go idle and have to be woken; "burst" pushes all at
+    // once, so later samples include the wait behind earlier tasks.
+    std::vector<Latency> MeasureLatency(const Options& _options) {
+        CT::CThreader threader;
+        threader.Initialize(_options.maxThreads);
+        threader.Start();
+
+        std::vector<Latency> results;
+        std::vector<int64_t> samples(_options.latencySamples);
+        for (const bool paced : { true, false }) {
+            std::fill(samples.begin(), samples.end(), 0);
+            for (size_t i = 0; i < samples.size(); ++i) {
+                const Clock::time_point pushed = Clock::now();
+                threader.Post(CT::Task([slot = &samples[i], pushed] {
+                    *slot = std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - pushed).count();
+                }));
+                if (paced) {
+                    const Clock::time_point until = pushed + std::chrono::microseconds(50);
+                    while (Clock::now() < until) {
+                    }
+                }
+            }
+            threader.WaitIdle();
+            results.push_back(Summarize(paced ? "paced" : "burst", samples));
+        }
+        return results;
+    }
+
+    void RunJobs(CT::CThreader& _threader, const Workload& _workload, size_t _jobs) {
+        for (size_t i = 0; i < _jobs; ++i) {
+            _threader.Post(CT::Task([&_workload] {
+                g_sink.fetch_add(_workload.run(), std::memory_order_relaxed);
+            }));
+        }
+        _threader.WaitIdle();
+    }
+
+    // Strong scaling: 2 * maxThreads jobs whatever the thread count. Weak
+    // scaling: 2 jobs per thread. One pool per thread count, shared by all
+    // workloads.
+    void MeasureScaling(const Options& _options, const std::vector<Workload>& _workloads, std::vector<WorkloadResult>& _results) {
+        const size_t strongJobs = 2 * _options.maxThreads;
+        for (const size_t threads : ThreadCounts(_options.maxThreads)) {
+            CT::CThreader threader;
+            threader.Initialize(threads);
+            threader.Start();
+
+            for (size_t w = 0; w < _workloads.size(); ++w) {
+                const Workload& workload = _workloads[w];
+                const size_t weakJobs = 2 * threads;
+                _results[w].strong.push_back({ threads, strongJobs, BestOf(_options.repeat, [&] { RunJobs(threader, workload, strongJobs); }) });
+                _results[w].weak.push_back({ threads, weakJobs, BestOf(_options.repeat, [&] { RunJobs(threader, workload, weakJobs); }) });
+                std::fprintf(stderr, "  %-30s %3zu threads  strong %.3fs  weak %.3fs\n",
+                    workload.name.c_str(), threads, _results[w].strong.back().seconds, _results[w].weak.back().seconds);
+            }
+        }
+    }
+
+    void MeasureAsync(const Options& _options, const std::vector<Workload>& _workloads, std::vector<WorkloadResult>& _results) {
+        CT::CThreader threader;
+        threader.Initialize(_options.maxThreads);
+        threader.Start();
+
+        const size_t jobs = 2 * _options.maxThreads;
+        std::vector<std::future<void>> futures(jobs);
+        for (size_t w = 0; w < _workloads.size(); ++w) {
+            const Workload& workload = _workloads[w];
+            _results[w].compareJobs = jobs;
+            _results[w].poolSeconds = BestOf(_options.repeat, [&] { RunJobs(threader, workload, jobs); });
+            _results[w].asyncSeconds = BestOf(_options.repeat, [&] {
+                for (auto& future : futures) {
+                    future = std::async(std::launch::async, [&workload] {
+                        g_sink.fetch_add(workload.run(), std::memory_order_relaxed);
+                    });
+                }
+                for (auto& future : futures) {
+                    future.get();
+                }
+            });
+            std::fprintf(stderr, "  %-30s pool %.3fs  std::async %.3fs\n",
+                workload.name.c_str(), _results[w].poolSeconds, _results[w].asyncSeconds);
+        }
+    }
+
+    std::string Escape(const std::string& _text) {
+        std::string escaped;
+        for (const char c : _text) {
+            if (c == '"' || c == '\\') {
+                escaped += '\\';
+            }
+            escaped += c;
+        }
+        return escaped;
+    }
+
+    void WritePoints(std::FILE* _out, const char* _key, const std::vector<ScalingPoint>& _points, bool _weak) {
+        std::fprintf(_out, "      \"%s\": [", _key);
+        const double base = _points.empty() ? 0 : _points.front().seconds;
+        for (size_t i = 0; i < _points.size(); ++i) {
+            const ScalingPoint& p = _points[i];
+            // Strong: speedup over 1 thread and speedup per thread. Weak:
+            // ideal is a flat time, so efficiency is just T1 / Tn.
+            const double speedup = p.seconds > 0 ? base / p.seconds : 0;
+            const double efficiency = _weak ? speedup : speedup / static_cast<double>(p.threads);
+            std::fprintf(_out, "%s\n        {\"threads\": %zu, \"jobs\": %zu, \"seconds\": %.6f, ", i == 0 ? "" : ",", p.threads, p.jobs, p.seconds);
+            if (!_weak) {
+                std::fprintf(_out, "\"speedup\": %.4f, ", speedup);
+            }
+            std::fprintf(_out, "\"efficiency\": %.4f}", efficiency);
+        }
+        std::fprintf(_out, "%s]", _points.empty() ? "" : "\n      ");
+    }
+
+    bool WriteJson(const Options& _options, const Throughput& _throughput, const std::vector<Latency>& _latency, const std::vector<WorkloadResult>& _workloads) {
+        std::FILE* out = std::fopen(_options.out.c_str(), "w");
+        if (!out) {
+            return false;
+        }
+
+#if defined(_MSC_VER)
+        const std::string compiler = "MSVC " + std::to_string(_MSC_VER);
+#elif defined(__clang__)
+        const std::string compiler = std::string("Clang ") + __clang_version__;
+#elif defined(__GNUC__)
+        const std::string compiler = std::string("GCC ") + __VERSION__;
+#else
+        const std::string compiler = "unknown";
+#endif
+
+        std::fprintf(out, "{\n  \"schema\": 1,\n");
+        std::fprintf(out, "  \"timestamp\": %lld,\n", static_cast<long long>(std::time(nullptr)));
+        std::fprintf(out, "  \"compiler\": \"%s\",\n  \"build_type\": \"%s\",\n", Escape(compiler).c_str(), CTHREADER_BENCH_BUILD_TYPE);
+        std::fprintf(out, "  \"hardware_concurrency\": %u,\n", std::thread::hardware_concurrency());
+        std::fprintf(out, "  \"options\": {\"max_threads\": %zu, \"repeat\": %zu, \"scale\": %g, \"metrics\": %s, \"tracing\": %s, \"perf_counters\": %s},\n",
+            _options.maxThreads, _options.repeat, _options.scale, CT::kMetricsEnabled ? "true" : "false",
+            CT::kTracingEnabled ? "true" : "false", CT::kPerfCountersEnabled ? "true" : "false");
+
+        std::fprintf(out, "  \"throughput\": {\"threads\": %zu, \"tasks\": %zu, \"post_per_s\": %.1f, \"post_batch_per_s\": %.1f, \"enqueue_per_s\": %.1f, \"async_tasks\": %zu, \"async_per_s\": %.1f},\n",
+            _throughput.threads, _throughput.tasks, _throughput.post, _throughput.postBatch, _throughput.enqueue, _throughput.asyncTasks, _throughput.async);
+
+        std::fprintf(out, "  \"latency_ns\": [");
+        for (size_t i = 0; i < _latency.size(); ++i) {
+            const Latency& l = _latency[i];
+            std::fprintf(out, "%s\n    {\"mode\": \"%s\", \"samples\": %zu, \"mean\": %.1f, \"p50\": %lld, \"p90\": %lld, \"p99\": %lld, \"p999\": %lld, \"max\": %lld}",
+                i == 0 ? "" : ",", l.mode.c_str(), l.samples, l.mean,
+                static_cast<long long>(l.p50), static_cast<long long>(l.p90), static_cast<long long>(l.p99),
+                static_cast<long long>(l.p999), static_cast<long long>(l.max));
+        }
+        std::fprintf(out, "%s],\n", _latency.empty() ? "" : "\n  ");
+
+        std::fprintf(out, "  \"workloads\": [");
+        for (size_t i = 0; i < _workloads.size(); ++i) {
+            const WorkloadResult& w = _workloads[i];
+            std::fprintf(out, "%s\n    {\n      \"name\": \"%s\",\n      \"serial_seconds\": %.6f,\n", i == 0 ? "" : ",", Escape(w.name).c_str(), w.serialSeconds);
+            WritePoints(out, "strong", w.strong, false);
+            std::fprintf(out, ",\n");
+            WritePoints(out, "weak", w.weak, true);
+            std::fprintf(out, ",\n      \"compare\": {\"jobs\": %zu, \"pool_seconds\": %.6f, \"async_seconds\": %.6f}\n    }",
+                w.compareJobs, w.poolSeconds, w.asyncSeconds);
+        }
+        std::fprintf(out, "%s]\n}\n", _workloads.empty() ? "" : "\n  ");
+        return std::fclose(out) == 0;
+    }
+
+    void PrintUsage() {
+        std::fprintf(stderr,
+            "usage: cthreader_bench [options]\n"
+            "  --threads N        largest pool size (default: hardware_concurrency)\n"
+            "  --repeat N         runs per measurement, best is kept (default 3)\n"
+            "  --scale F          workload size factor (default 1.0)\n"
+            "  --tasks N          empty tasks per throughput run (default 1000000)\n"
+            "  --samples N        latency samples per mode (default 20000)\n"
+            "  --only a,b         only these workloads, by full name or the part before an '_' (task1)\n"
+            "  --no-scaling       skip the scaling sweep\n"
+            "  --no-async         skip the std::async comparison\n"
+            "  --quick            --repeat 1 --scale 0.1 --tasks 100000 --samples 2000\n"
+            "  --out FILE         JSON output (default cthreader_bench.json)\n");
+    }
+
+    bool ParseOptions(int _argc, char** _argv, Options& _options) {
+        for (int i = 1; i < _argc; ++i) {
+            const char* arg = _argv[i];
+            const char* value = i + 1 < _argc ? _argv[i + 1] : nullptr;
+            const auto number = [&](size_t& _field) {
+                if (!value) {
+                    return false;
+                }
+                _field = std::max<size_t>(std::strtoull(value, nullptr, 10), 1);
+                ++i;
+                return true;
+            };
+
+            bool ok = true;
+            if (std::strcmp(arg, "--threads") == 0) { ok = number(_options.maxThreads); }
+            else if (std::strcmp(arg, "--repeat") == 0) { ok = number(_options.repeat); }
+            else if (std::strcmp(arg, "--tasks") == 0) { ok = number(_options.emptyTasks); }
+            else if (std::strcmp(arg, "--samples") == 0) { ok = number(_options.latencySamples); }
+            else if (std::strcmp(arg, "--scale") == 0 && value) { _options.scale = std::max(std::strtod(value, nullptr), 0.001); ++i; }
+            else if (std::strcmp(arg, "--only") == 0 && value) { _options.only = value; ++i; }
+            else if (std::strcmp(arg, "--out") == 0 && value) { _options.out = value; ++i; }
+            else if (std::strcmp(arg, "--no-scaling") == 0) { _options.scaling = false; }
+            else if (std::strcmp(arg, "--no-async") == 0) { _options.async = false; }
+            else if (std::strcmp(arg, "--quick") == 0) {
+                _options.repeat = 1;
+                _options.scale = 0.1;
+                _options.emptyTasks = 100'000;
+                _options.latencySamples = 2'000;
+            }
+            else { ok = false; }
+
+            if (!ok) {
+                PrintUsage();
+                return false;
+            }
+        }
+        return true;
+    }
+
+    bool Selected(const Options& _options, const std::string& _name) {
+        if (_options.only.empty()) {
+            return true;
+        }
+        size_t begin = 0;
+        while (begin <= _options.only.size()) {
+            const size_t end = std::min(_options.only.find(',', begin), _options.only.size());
+            const std::string part = _options.only.substr(begin, end - begin);
+            // Whole name, or its prefix up to an '_': task1 is task1_heavy_math, not task10_*.
+            if (!part.empty() && (_name == part || _name.rfind(part + "_", 0) == 0)) {
+                return true;
+            }
+            begin = end + 1;
+        }
+        return false;
+    }
+}
+
+int main(int argc, char** argv) {
+    Options options;
+    if (!ParseOptions(argc, argv, options)) {
+        return 2;
+    }
+
+    std::fprintf(stderr, "empty-task throughput, %zu threads\n", options.maxThreads);
+    const Throughput throughput = MeasureThroughput(options);
+    std::fprintf(stderr, "  Post %.0f/s  PostBatch %.0f/s  Enqueue %.0f/s  std::async %.0f/s\n",
+        throughput.post, throughput.postBatch, throughput.enqueue, throughput.async);
+
+    std::fprintf(stderr, "enqueue-to-start latency\n");
+    const std::vector<Latency> latency = MeasureLatency(options);
+    for (const Latency& l : latency) {
+        std::fprintf(stderr, "  %-6s p50 %lldns  p99 %lldns  p99.9 %lldns  max %lldns\n", l.mode.c_str(),
+            static_cast<long long>(l.p50), static_cast<long long>(l.p99), static_cast<long long>(l.p999), static_cast<long long>(l.max));
+    }
+
+    std::vector<Workload> workloads;
+    for (Workload& w : MakeWorkloads(options.scale)) {
+        if (Selected(options, w.name)) {
+            workloads.push_back(std::move(w));
+        }
+    }
+
+    std::vector<WorkloadResult> results(workloads.size());
+    std::fprintf(stderr, "serial baseline\n");
+    for (size_t w = 0; w < workloads.size(); ++w) {
+        results[w].name = workloads[w].name;
+        results[w].serialSeconds = BestOf(options.repeat, [&] {
+            g_sink.fetch_add(workloads[w].run(), std::memory_order_relaxed);
+        });
+        std::fprintf(stderr, "  %-30s %.3fs\n", workloads[w].name.c_str(), results[w].serialSeconds);
+    }
+    if (options.scaling) {
+        std::fprintf(stderr, "scaling\n");
+        MeasureScaling(options, workloads, results);
+    }
+    if (options.async) {
+        std::fprintf(stderr, "CThreader vs std::async, %zu jobs each\n", 2 * options.maxThreads);
+        MeasureAsync(options, workloads, results);
+    }
+
+    if (!WriteJson(options, throughput, latency, results)) {
+        std::fprintf(stderr, "could not write %s\n", options.out.c_str());
+        return 1;
+    }
+    std::fprintf(stderr, "wrote %s (checksum %llu)\n", options.out.c_str(), static_cast<unsigned long long>(g_sink.load()));
+    return 0;
+}
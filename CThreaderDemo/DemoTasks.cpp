@@ -8,6 +8,8 @@
 #include <unordered_map>
 #include <map>
 
+#include "CThreader/CThreader.hpp"
+
 #ifndef M_PI
 #define M_PI 3.14159265358979323846
 #endif
@@ -275,4 +277,39 @@ namespace Workloads {
         return is_prime;
     }
 
+
+    // =========================================
+    // PARALEL VARYANTLAR
+    // =========================================
+
+    double Task1_HeavyMathParallel(CT::CThreader& threader, long long iterations) {
+        return threader.ParallelReduce(0LL, iterations, 0LL, 0.0,
+            [](long long lo, long long hi) {
+                double result = 0.0;
+                for (long long i = lo; i < hi; ++i) {
+                    double d = static_cast<double>(i);
+                    result += std::sin(d) * std::cos(d) + std::sqrt(std::abs(std::tan(d) + 1.0));
+                }
+                return result;
+            },
+            [](double a, double b) { return a + b; });
+    }
+
+    size_t Task7_PrimeCounterParallel(CT::CThreader& threader, int start, int end) {
+        if (end < start) return 0;
+        return threader.ParallelReduce(start, end + 1, 0, size_t{ 0 },
+            [](int lo, int hi) { return Task7_PrimeCounter(lo, hi - 1); },
+            [](size_t a, size_t b) { return a + b; });
+    }
+
+    long long Task9_MonteCarloPiParallel(CT::CThreader& threader, long long iterations, int seed) {
+        constexpr long long kBlock = 1 << 16;
+        const long long blocks = (iterations + kBlock - 1) / kBlock;
+        return threader.ParallelReduce(0LL, blocks, 1LL, 0LL,
+            [=](long long block) {
+                const long long count = std::min(kBlock, iterations - block * kBlock);
+                return Task9_MonteCarloPi(count, seed + static_cast<int>(block));
+            },
+            [](long long a, long long b) { return a + b; });
+    }
 }
\ No newline at end of file
@@ -7,6 +7,8 @@
 #include <complex>
 #include <string>
 
+namespace CT { class CThreader; }
+
 namespace Workloads {
 
     // =========================================
@@ -78,6 +80,19 @@ namespace Workloads {
     // SENARYO 15: Sieve of Eratosthenes (Memory Write Intense)
     std::vector<bool> Task15_SieveOfEratosthenes(int up_to);
 
+    // =========================================
+    // PARALEL VARYANTLAR (CThreader::ParallelFor / ParallelReduce)
+    // =========================================
+
+    // SENARYO 1 (Paralel): Döngü CThreader havuzuna bölünür
+    double Task1_HeavyMathParallel(CT::CThreader& threader, long long iterations);
+
+    // SENARYO 7 (Paralel): Sayı aralığı havuza bölünür (dengesiz iş yükü)
+    size_t Task7_PrimeCounterParallel(CT::CThreader& threader, int start, int end);
+
+    // SENARYO 9 (Paralel): Her blok kendi tohumuyla (seed + blok) üretir; sonuç seri sürümle birebir aynı değildir
+    long long Task9_MonteCarloPiParallel(CT::CThreader& threader, long long iterations, int seed);
+
 }
 
 #endif
\ No newline at end of file
@@ -244,8 +244,8 @@ int main() {
     std::cout << "\n=== Sonuçlar (id, açıklama, değer) ===\n";
 
     auto printResult = [&](uint64_t id, const std::string& desc) {
-        // GetResult(id) -> std::optional<TaskResult* / TaskResultRef / benzeri> varsayıyorum.
-        auto result = threader.GetResult(id);
+        // TakeResult sonucu taşır ve slotunu boşaltır; GetResult slotu tutar.
+        auto result = threader.TakeResult(id);
 
         std::cout << " - [" << id << "] " << desc << " -> ";
         if (!result) {
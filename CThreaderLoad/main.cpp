@@ -0,0 +1,677 @@
+// main.cpp
+// cthreader_loadgen: replays a synthetic workload spec or a recorded arrival
+// trace against CThreader in open loop and reports throughput, queue wait
+// percentiles per TaskLevel and starvation events, per scheduling policy.
+//
+//     cthreader_loadgen skewed_mix.spec --policy all
+//     cthreader_loadgen --trace arrivals.csv --threads 8 --out run.json
+//
+// Open loop: tasks are pushed at their scheduled time whether or not the
+// pool keeps up, and wait is measured from that scheduled time, so a pool
+// that falls behind shows it in the numbers instead of slowing the load.
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <optional>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "CThreader/CThreader.hpp"
+
+namespace {
+    using Clock = std::chrono::steady_clock;
+
+    // Duration distribution of a task class, in ns.
+    struct Distribution {
+        enum class Kind { Fixed, Uniform, Exponential, LogNormal };
+
+        Kind kind{ Kind::Fixed };
+        double a{ 0 };
+        double b{ 0 };
+
+        int64_t Sample(std::mt19937_64& _rng) const {
+            double ns = a;
+            switch (kind) {
+            case Kind::Fixed:       break;
+            case Kind::Uniform:     ns = std::uniform_real_distribution<double>(a, b)(_rng); break;
+            case Kind::Exponential: ns = std::exponential_distribution<double>(1.0 / a)(_rng); break;
+            case Kind::LogNormal:   ns = std::lognormal_distribution<double>(std::log(a), b)(_rng); break;
+            }
+            return std::max<int64_t>(static_cast<int64_t>(ns), 0);
+        }
+    };
+
+    struct TaskClass {
+        std::string name;
+        double weight{ 1 };
+        uint32_t band{ static_cast<uint32_t>(CT::TaskLevel::Low) };
+        Distribution duration;
+        uint32_t fanout{ 0 };
+        // Relative to arrival; 0 for none.
+        int64_t deadline{ 0 };
+    };
+
+    // For length out of every period, class cls arrives on top of the mix
+    // at (factor - 1) times the base rate.
+    struct Burst {
+        int64_t every{ 0 };
+        int64_t length{ 0 };
+        double factor{ 1 };
+        size_t cls{ 0 };
+    };
+
+    struct Spec {
+        int64_t duration{ 1'000'000'000 };
+        double rate{ 10'000 };
+        uint64_t seed{ 1 };
+        size_t threads{ 0 };
+        int64_t starvation{ 100'000'000 };
+        std::string policy{ "fair" };
+        std::vector<TaskClass> classes;
+        std::vector<Burst> bursts;
+    };
+
+    struct Arrival {
+        // ns from the start of the run.
+        int64_t at{ 0 };
+        int64_t duration{ 0 };
+        int64_t deadline{ 0 };
+        uint32_t band{ 0 };
+        uint32_t fanout{ 0 };
+        // Children run at the parent's band; their durations live in
+        // Schedule::childDurations from firstChild on.
+        size_t firstChild{ 0 };
+    };
+
+    struct Schedule {
+        std::vector<Arrival> arrivals;
+        std::vector<int64_t> childDurations;
+        int64_t span{ 0 };
+    };
+
+    // Written by the task that owns it, read once the pool is idle.
+    struct Record {
+        int64_t ready{ 0 };
+        int64_t start{ 0 };
+        int64_t end{ 0 };
+        uint32_t band{ 0 };
+    };
+
+    struct LevelReport {
+        uint32_t band{ 0 };
+        size_t tasks{ 0 };
+        int64_t p50{ 0 }, p90{ 0 }, p99{ 0 }, p999{ 0 }, max{ 0 };
+        size_t starved{ 0 };
+    };
+
+    struct RunReport {
+        std::string policy;
+        size_t threads{ 0 };
+        size_t tasks{ 0 };
+        double offered{ 0 };
+        double throughput{ 0 };
+        double seconds{ 0 };
+        int64_t lagP99{ 0 };
+        int64_t lagMax{ 0 };
+        std::vector<LevelReport> levels;
+        CT::SchedulingStats scheduling;
+    };
+
+    int64_t Now() {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now().time_since_epoch()).count();
+    }
+
+    void SpinFor(int64_t _ns) {
+        const int64_t until = Now() + _ns;
+        while (Now() < until) {
+        }
+    }
+
+    // "500ns", "2.5us", "100ms", "1s"; a bare number is ns.
+    std::optional<int64_t> ParseDuration(const std::string& _text) {
+        char* rest = nullptr;
+        const double value = std::strtod(_text.c_str(), &rest);
+        if (rest == _text.c_str() || value < 0) {
+            return std::nullopt;
+        }
+        const std::string unit(rest);
+        double scale = 0;
+        if (unit.empty() || unit == "ns") { scale = 1; }
+        else if (unit == "us") { scale = 1e3; }
+        else if (unit == "ms") { scale = 1e6; }
+        else if (unit == "s") { scale = 1e9; }
+        else { return std::nullopt; }
+        return static_cast<int64_t>(value * scale);
+    }
+
+    std::optional<uint32_t> ParseLevel(const std::string& _text) {
+        if (_text == "low") { return static_cast<uint32_t>(CT::TaskLevel::Low); }
+        if (_text == "medium") { return static_cast<uint32_t>(CT::TaskLevel::Medium); }
+        if (_text == "high") { return static_cast<uint32_t>(CT::TaskLevel::High); }
+        char* rest = nullptr;
+        const unsigned long band = std::strtoul(_text.c_str(), &rest, 10);
+        if (rest == _text.c_str() || *rest != '\0' || band >= CT::kPriorityBands) {
+            return std::nullopt;
+        }
+        return static_cast<uint32_t>(band);
+    }
+
+    // fixed:D, uniform:MIN:MAX, exp:MEAN, lognormal:MEDIAN:SIGMA
+    std::optional<Distribution> ParseDistribution(const std::string& _text) {
+        std::vector<std::string> parts;
+        std::stringstream in(_text);
+        for (std::string part; std::getline(in, part, ':'); ) {
+            parts.push_back(part);
+        }
+
+        Distribution d;
+        const auto duration = [&](size_t _i, double& _out) {
+            const auto ns = _i < parts.size() ? ParseDuration(parts[_i]) : std::nullopt;
+            _out = ns ? static_cast<double>(*ns) : 0;
+            return ns.has_value();
+        };
+        if (parts.size() == 2 && parts[0] == "fixed" && duration(1, d.a)) {
+            d.kind = Distribution::Kind::Fixed;
+        }
+        else if (parts.size() == 3 && parts[0] == "uniform" && duration(1, d.a) && duration(2, d.b) && d.a <= d.b) {
+            d.kind = Distribution::Kind::Uniform;
+        }
+        else if (parts.size() == 2 && parts[0] == "exp" && duration(1, d.a) && d.a > 0) {
+            d.kind = Distribution::Kind::Exponential;
+        }
+        else if (parts.size() == 3 && parts[0] == "lognormal" && duration(1, d.a) && d.a > 0) {
+            d.kind = Distribution::Kind::LogNormal;
+            d.b = std::strtod(parts[2].c_str(), nullptr);
+        }
+        else {
+            return std::nullopt;
+        }
+        return d;
+    }
+
+    bool Fail(const std::string& _where, size_t _line, const std::string& _what) {
+        std::fprintf(stderr, "%s:%zu: %s\n", _where.c_str(), _line, _what.c_str());
+        return false;
+    }
+
+    // One directive per line, '#' starts a comment:
+    //     duration 5s | rate 20000 | seed 1 | threads 8 | starvation 50ms
+    //     policy strict|fair|age|edf
+    //     class NAME weight=W level=low|medium|high|BAND duration=DIST [fanout=N] [deadline=D]
+    //     burst every=D length=D factor=F class=NAME
+    bool LoadSpec(const std::string& _path, Spec& _spec) {
+        std::ifstream file(_path);
+        if (!file) {
+            std::fprintf(stderr, "cannot open %s\n", _path.c_str());
+            return false;
+        }
+
+        std::vector<std::pair<size_t, std::map<std::string, std::string>>> bursts;
+        size_t lineNo = 0;
+        for (std::string line; std::getline(file, line); ) {
+            ++lineNo;
+            line = line.substr(0, line.find('#'));
+            std::stringstream in(line);
+            std::string key;
+            if (!(in >> key)) {
+                continue;
+            }
+
+            if (key == "class" || key == "burst") {
+                std::map<std::string, std::string> fields;
+                std::string name;
+                if (key == "class" && !(in >> name)) {
+                    return Fail(_path, lineNo, "class needs a name");
+                }
+                for (std::string field; in >> field; ) {
+                    const size_t eq = field.find('=');
+                    if (eq == std::string::npos) {
+                        return Fail(_path, lineNo, "expected key=value, got " + field);
+                    }
+                    fields[field.substr(0, eq)] = field.substr(eq + 1);
+                }
+                if (key == "burst") {
+                    bursts.emplace_back(lineNo, std::move(fields));
+                    continue;
+                }
+
+                TaskClass cls;
+                cls.name = name;
+                cls.weight = fields.contains("weight") ? std::strtod(fields["weight"].c_str(), nullptr) : 1.0;
+                const auto level = ParseLevel(fields.contains("level") ? fields["level"] : "low");
+                const auto duration = ParseDistribution(fields.contains("duration") ? fields["duration"] : "");
+                const auto deadline = fields.contains("deadline") ? ParseDuration(fields["deadline"]) : std::optional<int64_t>(0);
+                if (!level || !duration || !deadline || cls.weight < 0) {
+                    return Fail(_path, lineNo, "bad class " + name);
+                }
+                cls.band = *level;
+                cls.duration = *duration;
+                cls.deadline = *deadline;
+                cls.fanout = fields.contains("fanout") ? static_cast<uint32_t>(std::strtoul(fields["fanout"].c_str(), nullptr, 10)) : 0;
+                _spec.classes.push_back(std::move(cls));
+                continue;
+            }
+
+            std::string value;
+            if (!(in >> value)) {
+                return Fail(_path, lineNo, key + " needs a value");
+            }
+            if (key == "duration" || key == "starvation") {
+                const auto ns = ParseDuration(value);
+                if (!ns) {
+                    return Fail(_path, lineNo, "bad duration " + value);
+                }
+                (key == "duration" ? _spec.duration : _spec.starvation) = *ns;
+            }
+            else if (key == "rate") { _spec.rate = std::strtod(value.c_str(), nullptr); }
+            else if (key == "seed") { _spec.seed = std::strtoull(value.c_str(), nullptr, 10); }
+            else if (key == "threads") { _spec.threads = std::strtoull(value.c_str(), nullptr, 10); }
+            else if (key == "policy") { _spec.policy = value; }
+            else { return Fail(_path, lineNo, "unknown directive " + key); }
+        }
+
+        // Bursts name classes that may be declared after them.
+        for (auto& [line, fields] : bursts) {
+            Burst burst;
+            const auto every = ParseDuration(fields["every"]);
+            const auto length = ParseDuration(fields["length"]);
+            const auto cls = std::find_if(_spec.classes.begin(), _spec.classes.end(), [&](const TaskClass& _c) { return _c.name == fields["class"]; });
+            burst.factor = std::strtod(fields["factor"].c_str(), nullptr);
+            if (!every || !length || *every <= 0 || burst.factor < 1 || cls == _spec.classes.end()) {
+                return Fail(_path, line, "bad burst");
+            }
+            burst.every = *every;
+            burst.length = *length;
+            burst.cls = static_cast<size_t>(cls - _spec.classes.begin());
+            _spec.bursts.push_back(burst);
+        }
+
+        if (_spec.classes.empty()) {
+            std::fprintf(stderr, "%s: no task classes\n", _path.c_str());
+            return false;
+        }
+        return true;
+    }
+
+    void AddChildren(Schedule& _schedule, Arrival& _arrival, const Distribution& _duration, std::mt19937_64& _rng) {
+        _arrival.firstChild = _schedule.childDurations.size();
+        for (uint32_t i = 0; i < _arrival.fanout; ++i) {
+            _schedule.childDurations.push_back(_duration.Sample(_rng));
+        }
+    }
+
+    // Poisson arrivals over the classes by weight, plus the extra arrivals
+    // of every burst window. Drawn up front so every policy replays the
+    // same schedule.
+    Schedule Generate(const Spec& _spec, double _rateScale) {
+        Schedule schedule;
+        std::mt19937_64 rng(_spec.seed);
+
+        std::vector<double> weights;
+        for (const TaskClass& cls : _spec.classes) {
+            weights.push_back(cls.weight);
+        }
+        std::discrete_distribution<size_t> pick(weights.begin(), weights.end());
+
+        const auto add = [&](int64_t _at, const TaskClass& _cls) {
+            Arrival arrival;
+            arrival.at = _at;
+            arrival.duration = _cls.duration.Sample(rng);
+            arrival.deadline = _cls.deadline;
+            arrival.band = _cls.band;
+            arrival.fanout = _cls.fanout;
+            AddChildren(schedule, arrival, _cls.duration, rng);
+            schedule.arrivals.push_back(arrival);
+        };
+
+        const double rate = _spec.rate * _rateScale;
+        if (rate > 0) {
+            std::exponential_distribution<double> gap(rate / 1e9);
+            for (double at = gap(rng); at < static_cast<double>(_spec.duration); at += gap(rng)) {
+                add(static_cast<int64_t>(at), _spec.classes[pick(rng)]);
+            }
+            for (const Burst& burst : _spec.bursts) {
+                std::exponential_distribution<double> extra(rate * (burst.factor - 1) / 1e9);
+                for (int64_t window = 0; window < _spec.duration && burst.factor > 1; window += burst.every) {
+                    const double end = static_cast<double>(std::min(window + burst.length, _spec.duration));
+                    for (double at = static_cast<double>(window) + extra(rng); at < end; at += extra(rng)) {
+                        add(static_cast<int64_t>(at), _spec.classes[burst.cls]);
+                    }
+                }
+            }
+        }
+
+        std::stable_sort(schedule.arrivals.begin(), schedule.arrivals.end(), [](const Arrival& _a, const Arrival& _b) { return _a.at < _b.at; });
+        schedule.span = _spec.duration;
+        return schedule;
+    }
+
+    // One arrival per line: arrival_us,duration_us,level[,fanout[,deadline_us]].
+    // Children get the parent's duration.
+    bool LoadTrace(const std::string& _path, Schedule& _schedule) {
+        std::ifstream file(_path);
+        if (!file) {
+            std::fprintf(stderr, "cannot open %s\n", _path.c_str());
+            return false;
+        }
+
+        size_t lineNo = 0;
+        for (std::string line; std::getline(file, line); ) {
+            ++lineNo;
+            line = line.substr(0, line.find('#'));
+            if (line.find_first_not_of(" \t\r") == std::string::npos) {
+                continue;
+            }
+
+            std::vector<std::string> fields;
+            std::stringstream in(line);
+            for (std::string field; std::getline(in, field, ','); ) {
+                field.erase(0, field.find_first_not_of(" \t"));
+                field.erase(field.find_last_not_of(" \t\r") + 1);
+                fields.push_back(field);
+            }
+            const auto level = fields.size() >= 3 ? ParseLevel(fields[2]) : std::nullopt;
+            if (!level) {
+                if (lineNo == 1) {
+                    continue; // header
+                }
+                return Fail(_path, lineNo, "expected arrival_us,duration_us,level[,fanout[,deadline_us]]");
+            }
+
+            Arrival arrival;
+            arrival.at = static_cast<int64_t>(std::strtod(fields[0].c_str(), nullptr) * 1e3);
+            arrival.duration = static_cast<int64_t>(std::strtod(fields[1].c_str(), nullptr) * 1e3);
+            arrival.band = *level;
+            arrival.fanout = fields.size() > 3 ? static_cast<uint32_t>(std::strtoul(fields[3].c_str(), nullptr, 10)) : 0;
+            arrival.deadline = fields.size() > 4 ? static_cast<int64_t>(std::strtod(fields[4].c_str(), nullptr) * 1e3) : 0;
+            arrival.firstChild = _schedule.childDurations.size();
+            _schedule.childDurations.insert(_schedule.childDurations.end(), arrival.fanout, arrival.duration);
+            _schedule.arrivals.push_back(arrival);
+        }
+
+        std::stable_sort(_schedule.arrivals.begin(), _schedule.arrivals.end(), [](const Arrival& _a, const Arrival& _b) { return _a.at < _b.at; });
+        if (!_schedule.arrivals.empty()) {
+            // Replay from the first arrival.
+            const int64_t first = _schedule.arrivals.front().at;
+            for (Arrival& arrival : _schedule.arrivals) {
+                arrival.at -= first;
+            }
+            _schedule.span = std::max<int64_t>(_schedule.arrivals.back().at, 1);
+        }
+        return true;
+    }
+
+    std::optional<CT::SchedulingPolicy> ParsePolicy(const std::string& _name) {
+        if (_name == "strict") { return CT::SchedulingPolicy::StrictPriority; }
+        if (_name == "fair") { return CT::SchedulingPolicy::WeightedFair; }
+        if (_name == "age") { return CT::SchedulingPolicy::AgePromotion; }
+        if (_name == "edf") { return CT::SchedulingPolicy::EarliestDeadline; }
+        return std::nullopt;
+    }
+
+    std::string LevelName(uint32_t _band) {
+        switch (static_cast<CT::TaskLevel>(_band)) {
+        case CT::TaskLevel::Low:    return "low";
+        case CT::TaskLevel::Medium: return "medium";
+        case CT::TaskLevel::High:   return "high";
+        default:                    return "band " + std::to_string(_band);
+        }
+    }
+
+    int64_t Percentile(const std::vector<int64_t>& _sorted, double _q) {
+        if (_sorted.empty()) {
+            return 0;
+        }
+        return _sorted[std::min(_sorted.size() - 1, static_cast<size_t>(_q * static_cast<double>(_sorted.size())))];
+    }
+
+    RunReport Replay(const Schedule& _schedule, const std::string& _policy, size_t _threads, int64_t _starvation) {
+        CT::CThreader threader;
+        threader.Initialize(_threads);
+        CT::SchedulingOptions options;
+        options.policy = *ParsePolicy(_policy);
+        threader.SetScheduling(options);
+        threader.Start();
+
+        const size_t parents = _schedule.arrivals.size();
+        std::vector<Record> records(parents + _schedule.childDurations.size());
+        std::vector<int64_t> lags(parents);
+
+        struct Context {
+            CT::CThreader& threader;
+            const Schedule& schedule;
+            std::vector<Record>& records;
+            size_t parents;
+        } context{ threader, _schedule, records, parents };
+
+        // Fan-out happens as the parent starts, from inside the pool, so the
+        // children take the nested-enqueue path.
+        const auto runChild = [&context](size_t _child) {
+            Record& record = context.records[context.parents + _child];
+            record.start = Now();
+            SpinFor(context.schedule.childDurations[_child]);
+            record.end = Now();
+        };
+        const auto runParent = [&context, runChild](size_t _index) {
+            const Arrival& arrival = context.schedule.arrivals[_index];
+            Record& record = context.records[_index];
+            record.start = Now();
+            for (uint32_t i = 0; i < arrival.fanout; ++i) {
+                const size_t child = arrival.firstChild + i;
+                context.records[context.parents + child].ready = record.start;
+                context.records[context.parents + child].band = arrival.band;
+                context.threader.Post(CT::Task([runChild, child] { runChild(child); }), CT::PriorityBand(arrival.band));
+            }
+            SpinFor(arrival.duration);
+            record.end = Now();
+        };
+
+        // Leave the workers time to start before the first arrival.
+        const int64_t origin = Now() + 10'000'000;
+        for (size_t i = 0; i < parents; ++i) {
+            const Arrival& arrival = _schedule.arrivals[i];
+            const int64_t due = origin + arrival.at;
+            // Sleep through long gaps, spin the last stretch.
+            if (const int64_t ahead = due - Now(); ahead > 200'000) {
+                std::this_thread::sleep_for(std::chrono::nanoseconds(ahead - 100'000));
+            }
+            while (Now() < due) {
+            }
+
+            records[i].ready = due;
+            records[i].band = arrival.band;
+            CT::Task task([runParent, i] { runParent(i); });
+            if (arrival.deadline != 0) {
+                const Clock::time_point deadline{ std::chrono::duration_cast<Clock::duration>(std::chrono::nanoseconds(due + arrival.deadline)) };
+                threader.Post(std::move(task), deadline, CT::PriorityBand(arrival.band));
+            }
+            else {
+                threader.Post(std::move(task), CT::PriorityBand(arrival.band));
+            }
+            lags[i] = Now() - due;
+        }
+        threader.WaitIdle();
+
+        RunReport report;
+        report.policy = _policy;
+        report.threads = threader.ActiveThreadCount();
+        report.tasks = records.size();
+        report.offered = static_cast<double>(parents) * 1e9 / static_cast<double>(_schedule.span);
+        int64_t last = origin;
+        std::map<uint32_t, std::vector<int64_t>> waits;
+        for (const Record& record : records) {
+            last = std::max(last, record.end);
+            waits[record.band].push_back(record.start - record.ready);
+        }
+        report.seconds = static_cast<double>(last - origin) / 1e9;
+        report.throughput = report.seconds > 0 ? static_cast<double>(records.size()) / report.seconds : 0;
+
+        std::sort(lags.begin(), lags.end());
+        report.lagP99 = Percentile(lags, 0.99);
+        report.lagMax = lags.empty() ? 0 : lags.back();
+
+        // Highest band first, as they are served.
+        for (auto it = waits.rbegin(); it != waits.rend(); ++it) {
+            std::vector<int64_t>& wait = it->second;
+            std::sort(wait.begin(), wait.end());
+            LevelReport level;
+            level.band = it->first;
+            level.tasks = wait.size();
+            level.p50 = Percentile(wait, 0.50);
+            level.p90 = Percentile(wait, 0.90);
+            level.p99 = Percentile(wait, 0.99);
+            level.p999 = Percentile(wait, 0.999);
+            level.max = wait.back();
+            level.starved = static_cast<size_t>(wait.end() - std::upper_bound(wait.begin(), wait.end(), _starvation));
+            report.levels.push_back(level);
+        }
+        report.scheduling = threader.GetSchedulingStats();
+        return report;
+    }
+
+    std::string Micros(int64_t _ns) {
+        char text[32];
+        std::snprintf(text, sizeof(text), "%.1fus", static_cast<double>(_ns) / 1e3);
+        return text;
+    }
+
+    void Print(const RunReport& _report, int64_t _starvation) {
+        std::printf("policy %-6s  %zu threads  %zu tasks in %.3fs  offered %.0f/s  throughput %.0f tasks/s  dispatch lag p99 %s max %s\n",
+            _report.policy.c_str(), _report.threads, _report.tasks, _report.seconds, _report.offered, _report.throughput,
+            Micros(_report.lagP99).c_str(), Micros(_report.lagMax).c_str());
+        std::printf("  %-8s %10s %12s %12s %12s %12s %12s %10s\n", "level", "tasks", "wait p50", "p90", "p99", "p99.9", "max",
+            ("> " + Micros(_starvation)).c_str());
+        for (const LevelReport& level : _report.levels) {
+            std::printf("  %-8s %10zu %12s %12s %12s %12s %12s %10zu\n", LevelName(level.band).c_str(), level.tasks,
+                Micros(level.p50).c_str(), Micros(level.p90).c_str(), Micros(level.p99).c_str(),
+                Micros(level.p999).c_str(), Micros(level.max).c_str(), level.starved);
+        }
+        const CT::SchedulingStats& s = _report.scheduling;
+        if (s.deadlineMet + s.deadlineMissed != 0) {
+            std::printf("  deadlines met %llu  missed %llu\n", static_cast<unsigned long long>(s.deadlineMet), static_cast<unsigned long long>(s.deadlineMissed));
+        }
+    }
+
+    bool WriteJson(const std::string& _path, const std::vector<RunReport>& _reports, int64_t _starvation) {
+        std::FILE* out = std::fopen(_path.c_str(), "w");
+        if (!out) {
+            return false;
+        }
+        std::fprintf(out, "{\n  \"starvation_ns\": %lld,\n  \"runs\": [", static_cast<long long>(_starvation));
+        for (size_t r = 0; r < _reports.size(); ++r) {
+            const RunReport& report = _reports[r];
+            std::fprintf(out, "%s\n    {\"policy\": \"%s\", \"threads\": %zu, \"tasks\": %zu, \"seconds\": %.6f, \"offered_per_s\": %.1f, \"throughput_per_s\": %.1f, "
+                "\"dispatch_lag_p99_ns\": %lld, \"dispatch_lag_max_ns\": %lld, \"deadline_met\": %llu, \"deadline_missed\": %llu, \"levels\": [",
+                r == 0 ? "" : ",", report.policy.c_str(), report.threads, report.tasks, report.seconds, report.offered, report.throughput,
+                static_cast<long long>(report.lagP99), static_cast<long long>(report.lagMax),
+                static_cast<unsigned long long>(report.scheduling.deadlineMet), static_cast<unsigned long long>(report.scheduling.deadlineMissed));
+            for (size_t l = 0; l < report.levels.size(); ++l) {
+                const LevelReport& level = report.levels[l];
+                std::fprintf(out, "%s\n      {\"level\": \"%s\", \"band\": %u, \"tasks\": %zu, \"wait_p50_ns\": %lld, \"wait_p90_ns\": %lld, "
+                    "\"wait_p99_ns\": %lld, \"wait_p999_ns\": %lld, \"wait_max_ns\": %lld, \"starved\": %zu}",
+                    l == 0 ? "" : ",", LevelName(level.band).c_str(), level.band, level.tasks,
+                    static_cast<long long>(level.p50), static_cast<long long>(level.p90), static_cast<long long>(level.p99),
+                    static_cast<long long>(level.p999), static_cast<long long>(level.max), level.starved);
+            }
+            std::fprintf(out, "%s]}", report.levels.empty() ? "" : "\n    ");
+        }
+        std::fprintf(out, "%s]\n}\n", _reports.empty() ? "" : "\n  ");
+        return std::fclose(out) == 0;
+    }
+
+    void PrintUsage() {
+        std::fprintf(stderr,
+            "usage: cthreader_loadgen SPEC [options]\n"
+            "       cthreader_loadgen --trace FILE.csv [options]\n"
+            "  --policy P         strict, fair, age, edf or all (default: the spec's, else fair)\n"
+            "  --threads N        pool size (default: the spec's, else hardware_concurrency)\n"
+            "  --rate-scale F     multiply the spec's arrival rate\n"
+            "  --seed N           override the spec's seed\n"
+            "  --starvation D     wait counted as starvation (default 100ms)\n"
+            "  --out FILE         also write the reports as JSON\n");
+    }
+}
+
+int main(int argc, char** argv) {
+    std::string specPath;
+    std::string tracePath;
+    std::string out;
+    std::optional<std::string> policy;
+    std::optional<size_t> threads;
+    std::optional<uint64_t> seed;
+    std::optional<int64_t> starvation;
+    double rateScale = 1.0;
+
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        const bool hasValue = i + 1 < argc;
+        if (arg == "--trace" && hasValue) { tracePath = argv[++i]; }
+        else if (arg == "--policy" && hasValue) { policy = argv[++i]; }
+        else if (arg == "--threads" && hasValue) { threads = std::strtoull(argv[++i], nullptr, 10); }
+        else if (arg == "--rate-scale" && hasValue) { rateScale = std::strtod(argv[++i], nullptr); }
+        else if (arg == "--seed" && hasValue) { seed = std::strtoull(argv[++i], nullptr, 10); }
+        else if (arg == "--starvation" && hasValue) { starvation = ParseDuration(argv[++i]); }
+        else if (arg == "--out" && hasValue) { out = argv[++i]; }
+        else if (arg[0] != '-' && specPath.empty()) { specPath = arg; }
+        else {
+            PrintUsage();
+            return 2;
+        }
+    }
+    if (specPath.empty() == tracePath.empty()) {
+        PrintUsage();
+        return 2;
+    }
+
+    Spec spec;
+    Schedule schedule;
+    if (!specPath.empty()) {
+        if (!LoadSpec(specPath, spec)) {
+            return 1;
+        }
+        if (seed) {
+            spec.seed = *seed;
+        }
+        schedule = Generate(spec, rateScale);
+    }
+    else if (!LoadTrace(tracePath, schedule)) {
+        return 1;
+    }
+
+    const int64_t starvationNs = starvation.value_or(spec.starvation);
+    const size_t poolSize = std::max<size_t>(threads.value_or(spec.threads != 0 ? spec.threads : std::thread::hardware_concurrency()), 1);
+    std::vector<std::string> policies;
+    if (const std::string chosen = policy.value_or(spec.policy); chosen == "all") {
+        policies = { "strict", "fair", "age", "edf" };
+    }
+    else if (ParsePolicy(chosen)) {
+        policies = { chosen };
+    }
+    else {
+        std::fprintf(stderr, "unknown policy %s\n", chosen.c_str());
+        return 2;
+    }
+
+    std::fprintf(stderr, "%zu arrivals (+%zu fan-out) over %.3fs\n", schedule.arrivals.size(), schedule.childDurations.size(),
+        static_cast<double>(schedule.span) / 1e9);
+    std::vector<RunReport> reports;
+    for (const std::string& name : policies) {
+        reports.push_back(Replay(schedule, name, poolSize, starvationNs));
+        Print(reports.back(), starvationNs);
+    }
+
+    if (!out.empty() && !WriteJson(out, reports, starvationNs)) {
+        std::fprintf(stderr, "could not write %s\n", out.c_str());
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,15 @@
+# Production-like skew: mostly sub-microsecond tasks, some fanned-out
+# requests, a rare 100ms monster, and a burst of High work every second.
+# Sized for about 4 busy cores; scale with --rate-scale.
+duration    5s
+rate        100000
+seed        1
+starvation  50ms
+policy      fair
+
+class tiny     weight=0.97    level=low     duration=exp:500ns
+class request  weight=0.0299  level=medium  duration=lognormal:20us:1.0  fanout=4
+class monster  weight=0.0001  level=low     duration=fixed:100ms
+class urgent   weight=0       level=high    duration=exp:2us  deadline=1ms
+
+burst every=1s length=100ms factor=5 class=urgent
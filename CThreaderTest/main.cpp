@@ -186,7 +186,7 @@ int main() {
     {
         const auto result = test.second();
         std::cout << test.first << ":" << AnyToString(result) << std::endl;
-		Sleep(2000);
+		std::this_thread::sleep_for(std::chrono::seconds(2));
     }
 	const auto elapsedTime = std::chrono::steady_clock::now() - startTime;
 	const auto elapsedTimeMs = std::chrono::duration<double>(elapsedTime);
@@ -218,27 +218,26 @@ int main() {
 		std::this_thread::sleep_for(std::chrono::milliseconds(1));
 	}
 
-	std::unordered_map<std::string, uint64_t> results;
+	std::vector<std::pair<std::string, CT::TaskHandle<std::any>>> handles;
 	for	(const auto& test : tests) {
-		const auto resultId = threader.Enqueue(CT::Task(test.second));
-		results.insert({ test.first, resultId });
+		handles.emplace_back(test.first, threader.Enqueue(TaskLevel::Low, test.second));
 	}
-	while (!results.empty())
+	for (auto& [name, handle] : handles)
 	{
-		for (auto it = results.begin(); it != results.end(); ) {
-			auto& name = it->first;
-			auto& resultId = it->second;
-			if (const auto result = threader.GetResult(resultId); result) {
-				if (result.value()) {
-					std::cout << name << ": " << AnyToString(result.value().GetValue()) << std::endl;
-					results.erase(it);
-				}
-			}
-			else
-			{
-				std::cout << name << ": Error ID: " << static_cast<int>(result.error()) << std::endl;
-			}
-		}
-		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		std::cout << name << ": " << AnyToString(handle.Get()) << std::endl;
 	}
+
+	// Seri ve paralel sürümler karşılaştırması (ParallelFor / ParallelReduce)
+	const auto timed = [](const char* _name, auto&& _fn) {
+		const auto begin = std::chrono::steady_clock::now();
+		const auto result = _fn();
+		const auto elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin);
+		std::cout << _name << ": " << result << " (" << elapsed << ")" << std::endl;
+	};
+	timed("task1 seri   ", [] { return Task1_HeavyMath(20'000'000LL); });
+	timed("task1 paralel", [&] { return Task1_HeavyMathParallel(threader, 20'000'000LL); });
+	timed("task7 seri   ", [] { return Task7_PrimeCounter(2, 2'000'000); });
+	timed("task7 paralel", [&] { return Task7_PrimeCounterParallel(threader, 2, 2'000'000); });
+	timed("task9 seri   ", [] { return Task9_MonteCarloPi(50'000'000LL, 9876); });
+	timed("task9 paralel", [&] { return Task9_MonteCarloPiParallel(threader, 50'000'000LL, 9876); });
 }
\ No newline at end of file